@@ -0,0 +1,99 @@
+#include "consoleio.h"
+#include <cstdlib>
+
+namespace {
+
+bool wants_color(ColorMode mode, int fd) {
+	if (mode != ColorMode::Auto) {
+		return mode == ColorMode::Always;
+	}
+	const char* no_color = std::getenv("NO_COLOR");
+	return ::isatty(fd) == 1 && (no_color == nullptr || *no_color == '\0');
+}
+
+}
+
+FastConsoleIO::FastConsoleIO(const ConsoleOptions& options)
+    : options(options)
+    , color_stdout(wants_color(options.color, options.stdout_fd))
+    , color_stderr(wants_color(options.color, options.stderr_fd))
+    , direct_stdout(::isatty(options.stdout_fd) == 1)
+    , direct_stderr(::isatty(options.stderr_fd) == 1)
+    , buffer_fd(options.stdout_fd) {
+	buffer.reserve(options.buffer_size);
+}
+
+FastConsoleIO::~FastConsoleIO() {
+	flush_buffer();
+}
+
+void FastConsoleIO::write_logger(const std::string& msg) {
+	write_leveled(msg, LogLevel::OFF);
+}
+
+void FastConsoleIO::write_leveled(const std::string& msg, LogLevel level) {
+	const bool leveled = level != LogLevel::OFF;
+	const bool severe = leveled && Weight(level) >= Weight(options.stderr_level);
+	const int fd = severe ? options.stderr_fd : options.stdout_fd;
+	const bool color = leveled && (severe ? color_stderr : color_stdout);
+	const std::string_view prefix = color ? kLevelColors[Weight(level)] : std::string_view {};
+	const std::string_view suffix = prefix.empty() ? std::string_view {} : kColorReset;
+
+	if (fd != buffer_fd) {
+		flush_buffer();
+		buffer_fd = fd;
+	}
+
+	/* the reset goes before the newline, so a colored line never bleeds into the next */
+	std::string_view body(msg);
+	const bool newline = !body.empty() && body.back() == '\n';
+	if (newline) {
+		body.remove_suffix(1);
+	}
+
+	/* a terminal gets every line at once, like a line buffered stream */
+	const bool direct = severe ? direct_stderr : direct_stdout;
+	const size_t size = prefix.size() + body.size() + suffix.size() + (newline ? 1 : 0);
+	if (direct || buffer.size() + size > options.buffer_size) {
+		iovec iov[] = {
+			{ buffer.data(), buffer.size() },
+			{ const_cast<char*>(prefix.data()), prefix.size() },
+			{ const_cast<char*>(body.data()), body.size() },
+			{ const_cast<char*>(suffix.data()), suffix.size() },
+			{ const_cast<char*>("\n"), newline ? size_t { 1 } : size_t { 0 } },
+		};
+		writev_fully(fd, iov, static_cast<int>(sizeof(iov) / sizeof(iov[0])));
+		buffer.clear();
+		return;
+	}
+	buffer.append(prefix).append(body).append(suffix);
+	if (newline) {
+		buffer.push_back('\n');
+	}
+}
+
+void FastConsoleIO::force_flush() {
+	flush_buffer();
+}
+
+void FastConsoleIO::end_batch() {
+	flush_buffer();
+}
+
+void FastConsoleIO::flush_buffer() {
+	if (!buffer.empty()) {
+		write_fully(buffer_fd, buffer.data(), buffer.size());
+		buffer.clear();
+	}
+}
+
+void FastConsoleIO::emergency_flush() noexcept {
+	if (!buffer.empty()) {
+		write_fully(buffer_fd, buffer.data(), buffer.size());
+		buffer.clear();
+	}
+}
+
+bool FastConsoleIO::emergency_write(const char* data, size_t size) noexcept {
+	return write_fully(options.stdout_fd, data, size);
+}
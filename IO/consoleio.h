@@ -0,0 +1,118 @@
+/**
+ * @file consoleio.h
+ * @brief Defines the FastConsoleIO class, which writes log lines straight to the stdout/stderr file descriptors.
+ */
+
+#pragma once
+
+#include "core/logger_tools.h"
+#include "io.h"
+#include "tools/class_helper.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+/**
+ * @enum ColorMode
+ * @brief When FastConsoleIO colors lines by level.
+ */
+enum class ColorMode : uint8_t {
+	Auto, ///< Only streams attached to a terminal, and only if NO_COLOR is unset or empty.
+	Always, ///< Always, e.g. for a collector that renders ANSI codes.
+	Never ///< Never.
+};
+
+/**
+ * @brief Tuning of a FastConsoleIO.
+ */
+struct ConsoleOptions {
+	ColorMode color { ColorMode::Auto }; ///< When to color lines by level.
+	LogLevel stderr_level { LogLevel::ERROR }; ///< Lines at or above this level go to stderr_fd.
+	int stdout_fd { STDOUT_FILENO }; ///< Where the other lines go.
+	int stderr_fd { STDERR_FILENO }; ///< Where the severe lines go.
+	size_t buffer_size { 64 * 1024 }; ///< Bytes buffered before a write.
+};
+
+/**
+ * @brief Implementation of AbstractIO that writes to the console without iostreams.
+ *
+ * Lines are buffered and written with plain write/writev calls, so there is
+ * no sentry, locale or stdio synchronization per line. The level is the
+ * record's, passed by the worker through write_leveled(); the text is never
+ * parsed for it. Lines at or above stderr_level go to stderr, and on a
+ * terminal a line is wrapped in its kLevelColors sequence. Lines without a
+ * level (OFF, or written with write_logger()) go to stdout uncolored. The buffer is written whenever the target stream
+ * changes, so stdout and stderr lines keep their relative order, and at
+ * the end of every worker batch (end_batch()). Lines for a terminal are
+ * not buffered at all.
+ */
+class FastConsoleIO : public AbstractIO {
+public:
+	DISABLE_COPY_MOVE(FastConsoleIO);
+
+	/**
+	 * @brief Creates the sink and decides per stream whether to color.
+	 *
+	 * @param options Tuning, see ConsoleOptions.
+	 */
+	explicit FastConsoleIO(const ConsoleOptions& options = {});
+
+	/**
+	 * @brief Destructor. Writes what is still buffered.
+	 */
+	~FastConsoleIO() override;
+
+	/**
+	 * @brief Buffers a line without a level for stdout, see write_leveled().
+	 *
+	 * @param msg The log line.
+	 */
+	void write_logger(const std::string& msg) override;
+
+	/**
+	 * @brief Buffers a line for the stream of its level; a line that does not fit goes out together with the buffer in one writev.
+	 *
+	 * @param msg The log line.
+	 * @param level The record's level, OFF for none.
+	 */
+	void write_leveled(const std::string& msg, LogLevel level) override;
+
+	/**
+	 * @brief Writes the buffer to its stream.
+	 */
+	void force_flush() override;
+
+	/**
+	 * @brief Writes the buffer, so a batch is visible as soon as the worker finished it.
+	 */
+	void end_batch() override;
+
+	/**
+	 * @copydoc AbstractIO::emergency_flush
+	 */
+	void emergency_flush() noexcept override;
+
+	/**
+	 * @copydoc AbstractIO::emergency_write
+	 */
+	bool emergency_write(const char* data, size_t size) noexcept override;
+
+	bool get_stdout_colored() const { return color_stdout; } ///< Whether stdout lines are colored.
+	bool get_stderr_colored() const { return color_stderr; } ///< Whether stderr lines are colored.
+
+private:
+	/**
+	 * @brief Writes and clears the buffer.
+	 */
+	void flush_buffer();
+
+	ConsoleOptions options; ///< Tuning.
+	bool color_stdout; ///< Color lines going to stdout_fd.
+	bool color_stderr; ///< Color lines going to stderr_fd.
+	bool direct_stdout; ///< stdout_fd is a terminal, lines skip the buffer.
+	bool direct_stderr; ///< stderr_fd is a terminal, lines skip the buffer.
+	std::string buffer; ///< Lines not written yet, all for buffer_fd.
+	int buffer_fd; ///< Stream the buffered lines belong to.
+};
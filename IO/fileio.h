@@ -7,35 +7,48 @@
 
 #include "io.h"
 #include <fcntl.h> ///< open
-#include <fstream>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <unistd.h> ///< fsync
+#include <unistd.h> ///< write, fsync
 
 /**
  * @brief Implementation of AbstractIO that writes log messages to a file.
  *
- * This class uses std::ofstream for convenient C++ file writing,
- * but also maintains a native file descriptor to ensure data is physically
- * flushed to disk using fsync.
+ * Messages are collected in an in-memory buffer that is written to the
+ * native file descriptor with write(2) when it fills up or on force_flush(),
+ * followed by fsync so the data is physically on disk. Owning the buffer
+ * (instead of going through std::ofstream) lets the crash path hand it to
+ * the kernel with a single async-signal-safe write.
  */
 class FileIO : public AbstractIO {
 private:
-	std::ofstream ofs; ///< Output file stream for high-level file writing.
-	int fd { -1 }; ///< Native file descriptor to enable real fsync for guaranteed durability.
+	static constexpr size_t kBufferSize = 64 * 1024; ///< Buffered bytes that trigger a write(2).
+
+	int fd { -1 }; ///< Native file descriptor, opened for appending.
+	std::string buffer; ///< Bytes accepted by write_logger but not yet written.
+
+	/**
+	 * @brief Hands the buffer to the kernel.
+	 */
+	void write_out() noexcept {
+		if (fd != -1 && !buffer.empty()) {
+			write_fully(fd, buffer.data(), buffer.size());
+		}
+		buffer.clear();
+	}
 
 public:
 	/**
 	 * @brief Constructs a FileIO object with the given file path.
 	 *
-	 * Opens the file in append mode. Also obtains a native file descriptor for fsync.
+	 * Opens (creating if needed) the file in append mode.
 	 *
 	 * @param file_path The path to the log file.
 	 */
-	explicit FileIO(const std::string& file_path)
-	    : ofs(file_path, std::ios_base::app) {
-		fd = ::open(file_path.c_str(), O_WRONLY | O_APPEND);
+	explicit FileIO(const std::string& file_path) {
+		fd = ::open(file_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+		buffer.reserve(kBufferSize);
 	}
 
 	/**
@@ -44,31 +57,46 @@ public:
 	 * @param msg The log message to write.
 	 */
 	void write_logger(const std::string& msg) override {
-		ofs << msg;
+		buffer.append(msg);
+		if (buffer.size() >= kBufferSize) {
+			write_out();
+		}
 	}
 
 	/**
-	 * @brief Flushes the output stream and forces data to be written to disk.
+	 * @brief Flushes the buffer and forces data to be written to disk.
 	 *
-	 * This method calls both std::ofstream::flush and ::fsync to ensure
+	 * This method calls both write(2) and ::fsync to ensure
 	 * the log message is truly persisted.
 	 */
 	void force_flush() override {
-		ofs.flush();
+		write_out();
 		if (fd != -1) {
 			::fsync(fd);
 		}
 	}
 
+	/**
+	 * @copydoc AbstractIO::emergency_flush
+	 */
+	void emergency_flush() noexcept override { write_out(); }
+
+	/**
+	 * @copydoc AbstractIO::emergency_write
+	 */
+	bool emergency_write(const char* data, size_t size) noexcept override {
+		return fd != -1 && write_fully(fd, data, size);
+	}
+
 	/**
 	 * @brief Destructor.
 	 *
-	 * Closes the native file descriptor and the output file stream.
+	 * Writes what is still buffered and closes the native file descriptor.
 	 */
 	~FileIO() {
+		write_out();
 		if (fd != -1) {
 			::close(fd);
 		}
-		ofs.close();
 	}
 };
@@ -1,5 +1,59 @@
 #pragma once
+#include "core/logger_tools.h"
+#include <cerrno>
+#include <cstddef>
 #include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * @brief writes all of data to fd, retrying on short writes and EINTR,
+ *        async-signal-safe
+ *
+ * @return false on any other error
+ */
+inline bool write_fully(int fd, const char* data, size_t size) noexcept {
+	while (size > 0) {
+		const ssize_t n = ::write(fd, data, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+/**
+ * @brief gathers iov into fd with as few writev calls as possible, retrying
+ *        on short writes and EINTR; iov is consumed in place
+ *
+ * @return false on any other error
+ */
+inline bool writev_fully(int fd, iovec* iov, int count) noexcept {
+	while (count > 0) {
+		const ssize_t n = ::writev(fd, iov, count);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		size_t left = static_cast<size_t>(n);
+		while (count > 0 && left >= iov->iov_len) {
+			left -= iov->iov_len;
+			++iov;
+			--count;
+		}
+		if (count > 0) {
+			iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+			iov->iov_len -= left;
+		}
+	}
+	return true;
+}
+
 struct AbstractIO {
 	/**
 	 * @brief the interface of the logger writing
@@ -7,10 +61,46 @@ struct AbstractIO {
 	 * @param msg
 	 */
 	virtual void write_logger(const std::string& msg) = 0;
+	/**
+	 * @brief the interface of the logger writing, with the level of the
+	 *        record the line was formatted from, OFF when the producer gave
+	 *        none. The CCLogger worker calls this one; sinks that route or
+	 *        color by level override it. The default ignores the level
+	 *
+	 * @param msg
+	 * @param level
+	 */
+	virtual void write_leveled(const std::string& msg, [[maybe_unused]] LogLevel level) { write_logger(msg); }
 	/**
 	 * @brief force the all write, this is expected to be sync!
 	 *
 	 */
 	virtual void force_flush() = 0;
+	/**
+	 * @brief called by the worker after every batch it wrote: hands what
+	 *        write_logger buffered to the OS so lines show up without
+	 *        waiting for a full buffer. Unlike force_flush it need not
+	 *        sync. The default keeps buffering
+	 *
+	 */
+	virtual void end_batch() { }
+	/**
+	 * @brief crash path: hands whatever write_logger buffered to the OS,
+	 *        must only use async-signal-safe calls (no locks, no allocation).
+	 *        The default has nothing buffered to save
+	 *
+	 */
+	virtual void emergency_flush() noexcept { }
+	/**
+	 * @brief crash path: writes raw bytes straight to the sink, same
+	 *        restrictions as emergency_flush
+	 *
+	 * @param data
+	 * @param size
+	 * @return false if this sink has no async-signal-safe path
+	 */
+	virtual bool emergency_write([[maybe_unused]] const char* data, [[maybe_unused]] size_t size) noexcept {
+		return false;
+	}
 	virtual ~AbstractIO() = default;
 };
@@ -0,0 +1,283 @@
+#include "socketio.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kMaxBatch = 64; ///< Datagrams per sendmmsg / iovecs per stream sendmsg.
+
+bool would_block(int error) {
+	return error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS;
+}
+
+}
+
+SocketIO::SocketIO(SocketEndpoint endpoint, SocketOptions options)
+    : endpoint(std::move(endpoint))
+    , options(std::move(options)) {
+	if (this->options.syslog_framing) {
+		syslog_header = "<" + std::to_string(this->options.syslog_priority) + ">" + this->options.syslog_tag + "["
+		    + std::to_string(::getpid()) + "]: ";
+	}
+	current.reserve(this->options.max_datagram);
+}
+
+SocketIO::~SocketIO() {
+	force_flush();
+	disconnect();
+}
+
+bool SocketIO::ensure_connected() {
+	if (fd != -1) {
+		return true;
+	}
+	const auto now = std::chrono::steady_clock::now();
+	if (last_connect != std::chrono::steady_clock::time_point {} && now - last_connect < options.reconnect_interval) {
+		return false;
+	}
+	last_connect = now;
+
+	const bool unix_socket = endpoint.kind != SocketEndpoint::Kind::Udp;
+	const int type = (is_stream() ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK | SOCK_CLOEXEC;
+	fd = ::socket(unix_socket ? AF_UNIX : AF_INET, type, 0);
+	if (fd == -1) {
+		return false;
+	}
+
+	int result;
+	if (unix_socket) {
+		sockaddr_un address {};
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, endpoint.path.c_str(), sizeof(address.sun_path) - 1);
+		result = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	} else {
+		sockaddr_in address {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(endpoint.port);
+		::inet_pton(AF_INET, endpoint.host.c_str(), &address.sin_addr);
+		result = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	}
+	/* a non-blocking stream connect completes later, send_pending sees the outcome */
+	if (result != 0 && errno != EINPROGRESS) {
+		disconnect();
+		return false;
+	}
+	return true;
+}
+
+void SocketIO::disconnect() {
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+	/* a new stream must not start in the middle of a chunk */
+	if (sent_offset > 0 && !pending.empty()) {
+		pending_bytes -= pending.front().size();
+		spare.push_back(std::move(pending.front()));
+		pending.pop_front();
+		sent_offset = 0;
+	}
+}
+
+void SocketIO::seal() {
+	if (current.empty()) {
+		return;
+	}
+	pending_bytes += current.size();
+	pending.push_back(std::move(current));
+	if (!spare.empty()) {
+		current = std::move(spare.back());
+		spare.pop_back();
+		current.clear();
+	} else {
+		current = std::string();
+		current.reserve(options.max_datagram);
+	}
+	enforce_bound();
+}
+
+void SocketIO::drop_front() {
+	const size_t size = pending.front().size();
+	dropped_bytes += size - sent_offset;
+	pending_bytes -= size;
+	spare.push_back(std::move(pending.front()));
+	pending.pop_front();
+	sent_offset = 0;
+}
+
+void SocketIO::enforce_bound() {
+	while (pending_bytes > options.max_pending_bytes && pending.size() > 1) {
+		const bool partly_sent = sent_offset > 0;
+		drop_front();
+		/* a stream chunk cut short would corrupt the framing, restart the stream */
+		if (partly_sent) {
+			disconnect();
+		}
+	}
+}
+
+void SocketIO::write_logger(const std::string& msg) {
+	std::string_view line(msg);
+	if (options.syslog_framing) {
+		/* one message per datagram, without the trailing newline */
+		if (!line.empty() && line.back() == '\n') {
+			line.remove_suffix(1);
+		}
+		seal();
+		if (is_stream()) {
+			current.append(std::to_string(syslog_header.size() + line.size())).push_back(' ');
+		} else if (syslog_header.size() + line.size() > options.max_datagram) {
+			line = line.substr(0, options.max_datagram - std::min(options.max_datagram, syslog_header.size()));
+		}
+		current.append(syslog_header).append(line);
+		seal();
+	} else {
+		if (!current.empty() && current.size() + line.size() > options.max_datagram) {
+			seal();
+		}
+		/* a datagram cannot hold more, the collector sees the pieces back to back */
+		while (!is_stream() && line.size() > options.max_datagram) {
+			current.append(line.substr(0, options.max_datagram));
+			line.remove_prefix(options.max_datagram);
+			seal();
+		}
+		current.append(line);
+	}
+	if (pending.size() >= options.batch_datagrams) {
+		send_pending();
+	}
+}
+
+bool SocketIO::send_pending() {
+	if (pending.empty()) {
+		return true;
+	}
+	if (!ensure_connected()) {
+		return true;
+	}
+
+	while (!pending.empty()) {
+		const size_t batch = std::min(pending.size(), kMaxBatch);
+		iovec iov[kMaxBatch];
+		for (size_t i = 0; i < batch; ++i) {
+			const size_t skip = i == 0 ? sent_offset : 0;
+			iov[i].iov_base = pending[i].data() + skip;
+			iov[i].iov_len = pending[i].size() - skip;
+		}
+
+		if (is_stream()) {
+			msghdr message {};
+			message.msg_iov = iov;
+			message.msg_iovlen = batch;
+			const ssize_t sent = ::sendmsg(fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (sent < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (would_block(errno) || errno == ENOTCONN) {
+					return true;
+				}
+				disconnect();
+				return false;
+			}
+			++sent_datagrams;
+			size_t left = static_cast<size_t>(sent);
+			while (left > 0) {
+				const size_t rest = pending.front().size() - sent_offset;
+				if (left < rest) {
+					sent_offset += left;
+					break;
+				}
+				left -= rest;
+				pending_bytes -= pending.front().size();
+				spare.push_back(std::move(pending.front()));
+				pending.pop_front();
+				sent_offset = 0;
+			}
+			continue;
+		}
+
+		mmsghdr messages[kMaxBatch] {};
+		for (size_t i = 0; i < batch; ++i) {
+			messages[i].msg_hdr.msg_iov = &iov[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		const int sent = ::sendmmsg(fd, messages, static_cast<unsigned>(batch), MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (would_block(errno)) {
+				return true;
+			}
+			/* retrying cannot help and would hold up everything behind it */
+			if (errno == EMSGSIZE) {
+				++oversized_datagrams;
+				drop_front();
+				continue;
+			}
+			/* e.g. ECONNREFUSED: nobody listens (yet), keep the data and reconnect later */
+			disconnect();
+			return false;
+		}
+		sent_datagrams += static_cast<uint64_t>(sent);
+		for (int i = 0; i < sent; ++i) {
+			pending_bytes -= pending.front().size();
+			spare.push_back(std::move(pending.front()));
+			pending.pop_front();
+		}
+		if (static_cast<size_t>(sent) < batch) {
+			return true;
+		}
+	}
+	return true;
+}
+
+void SocketIO::force_flush() {
+	seal();
+	const auto deadline = std::chrono::steady_clock::now() + options.flush_timeout;
+	while (true) {
+		const bool healthy = send_pending();
+		if (pending.empty() || !healthy || fd == -1) {
+			return;
+		}
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (left.count() <= 0) {
+			return;
+		}
+		pollfd waiter { fd, POLLOUT, 0 };
+		if (::poll(&waiter, 1, static_cast<int>(left.count())) <= 0) {
+			return;
+		}
+	}
+}
+
+void SocketIO::end_batch() {
+	seal();
+	send_pending();
+}
+
+void SocketIO::emergency_flush() noexcept {
+	if (fd == -1) {
+		return;
+	}
+	for (size_t i = 0; i < pending.size(); ++i) {
+		const size_t skip = i == 0 ? sent_offset : 0;
+		::send(fd, pending[i].data() + skip, pending[i].size() - skip, MSG_DONTWAIT | MSG_NOSIGNAL);
+	}
+	if (!current.empty()) {
+		::send(fd, current.data(), current.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+	}
+}
+
+bool SocketIO::emergency_write(const char* data, size_t size) noexcept {
+	return fd != -1 && ::send(fd, data, size, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0;
+}
\ No newline at end of file
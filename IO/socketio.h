@@ -0,0 +1,163 @@
+/**
+ * @file socketio.h
+ * @brief Defines the SocketIO class, which ships log lines to a local collector over a Unix or UDP socket.
+ */
+
+#pragma once
+
+#include "io.h"
+#include "tools/class_helper.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where a SocketIO sends to.
+ */
+struct SocketEndpoint {
+	/**
+	 * @enum Kind
+	 * @brief Socket family and type.
+	 */
+	enum class Kind : uint8_t {
+		UnixDatagram, ///< AF_UNIX SOCK_DGRAM, e.g. /dev/log.
+		UnixStream, ///< AF_UNIX SOCK_STREAM.
+		Udp ///< AF_INET SOCK_DGRAM, normally to 127.0.0.1.
+	};
+
+	Kind kind { Kind::UnixDatagram }; ///< Socket family and type.
+	std::string path; ///< Socket path for the Unix kinds.
+	std::string host { "127.0.0.1" }; ///< IPv4 address for Udp.
+	uint16_t port { 514 }; ///< Port for Udp.
+
+	static SocketEndpoint unix_datagram(std::string path) { return { Kind::UnixDatagram, std::move(path) }; }
+	static SocketEndpoint unix_stream(std::string path) { return { Kind::UnixStream, std::move(path) }; }
+	static SocketEndpoint udp(std::string host, uint16_t port) { return { Kind::Udp, {}, std::move(host), port }; }
+};
+
+/**
+ * @brief Tuning of a SocketIO.
+ */
+struct SocketOptions {
+	bool syslog_framing { false }; ///< Send each line as a "<PRI>TAG[pid]: line" syslog message, one per datagram (octet counted on streams).
+	int syslog_priority { 14 }; ///< facility * 8 + severity, 14 is user.info.
+	std::string syslog_tag { "cclogger" }; ///< The syslog TAG field.
+	size_t max_datagram { 8192 }; ///< Bytes packed into one datagram, longer lines are split (truncated with syslog framing); use ~1400 for UDP.
+	size_t batch_datagrams { 32 }; ///< Sealed datagrams that trigger a sendmmsg before the batch ends.
+	size_t max_pending_bytes { 1 << 20 }; ///< Retry buffer bound; the oldest data is dropped beyond it.
+	std::chrono::milliseconds flush_timeout { 100 }; ///< Longest force_flush() waits for a slow collector.
+	std::chrono::milliseconds reconnect_interval { 1000 }; ///< Minimum delay between connection attempts.
+};
+
+/**
+ * @brief Implementation of AbstractIO that sends log lines to a local collector.
+ *
+ * Lines are packed into datagrams of up to max_datagram bytes (or one line
+ * per datagram with syslog framing) and sent in batches with a single
+ * sendmmsg; stream sockets send the batch with one sendmsg. What is buffered
+ * goes out at the end of every worker batch (end_batch()). The socket is
+ * non-blocking: data the collector cannot take yet stays in a bounded retry
+ * buffer, so a slow or absent collector costs dropped lines, never a blocked
+ * worker. A datagram the kernel refuses as too large is dropped and counted.
+ * force_flush() waits for the socket at most flush_timeout.
+ */
+class SocketIO : public AbstractIO {
+public:
+	DISABLE_COPY_MOVE(SocketIO);
+
+	/**
+	 * @brief Creates the sink; connecting is lazy and retried, a missing collector is not an error.
+	 *
+	 * @param endpoint Where to send.
+	 * @param options Tuning, see SocketOptions.
+	 */
+	explicit SocketIO(SocketEndpoint endpoint, SocketOptions options = {});
+
+	/**
+	 * @brief Destructor. Sends what it can within flush_timeout and closes the socket.
+	 */
+	~SocketIO() override;
+
+	/**
+	 * @brief Queues a line, sending a batch once batch_datagrams datagrams are sealed.
+	 *
+	 * @param msg The log line.
+	 */
+	void write_logger(const std::string& msg) override;
+
+	/**
+	 * @brief Sends everything buffered, waiting at most flush_timeout for the collector.
+	 */
+	void force_flush() override;
+
+	/**
+	 * @brief Sends the batch's datagrams, without waiting for a slow collector.
+	 */
+	void end_batch() override;
+
+	/**
+	 * @copydoc AbstractIO::emergency_flush
+	 */
+	void emergency_flush() noexcept override;
+
+	/**
+	 * @copydoc AbstractIO::emergency_write
+	 */
+	bool emergency_write(const char* data, size_t size) noexcept override;
+
+	uint64_t get_sent_datagrams() const { return sent_datagrams; } ///< Datagrams (or stream batches) handed to the kernel.
+	uint64_t get_dropped_bytes() const { return dropped_bytes; } ///< Bytes dropped because the retry buffer was full or a datagram was too large.
+	uint64_t get_oversized_datagrams() const { return oversized_datagrams; } ///< Datagrams dropped because the kernel refused their size (EMSGSIZE).
+	size_t get_pending_bytes() const { return pending_bytes; } ///< Bytes waiting in the retry buffer.
+
+private:
+	bool is_stream() const { return endpoint.kind == SocketEndpoint::Kind::UnixStream; }
+
+	/**
+	 * @brief Opens and connects the socket if it is not connected, rate limited by reconnect_interval.
+	 */
+	bool ensure_connected();
+
+	/**
+	 * @brief Closes the socket, the next send reconnects.
+	 */
+	void disconnect();
+
+	/**
+	 * @brief Moves the datagram being filled to the pending list.
+	 */
+	void seal();
+
+	/**
+	 * @brief Sends as much of the pending list as the socket takes without blocking.
+	 * @return false on an error other than "would block".
+	 */
+	bool send_pending();
+
+	/**
+	 * @brief Drops pending.front() unsent.
+	 */
+	void drop_front();
+
+	/**
+	 * @brief Drops the oldest pending datagrams until the buffer is within max_pending_bytes.
+	 */
+	void enforce_bound();
+
+	SocketEndpoint endpoint; ///< Where to send.
+	SocketOptions options; ///< Tuning.
+	int fd { -1 }; ///< The socket, -1 when not connected.
+	std::chrono::steady_clock::time_point last_connect {}; ///< Last connection attempt.
+	std::string current; ///< Datagram being filled.
+	std::deque<std::string> pending; ///< Sealed datagrams (or stream chunks), oldest first.
+	size_t sent_offset { 0 }; ///< Stream only: bytes of pending.front() already sent.
+	size_t pending_bytes { 0 }; ///< Bytes in pending, sent_offset not subtracted.
+	std::vector<std::string> spare; ///< Recycled datagram buffers.
+	std::string syslog_header; ///< "<PRI>TAG[pid]: ", built once.
+	uint64_t sent_datagrams { 0 };
+	uint64_t dropped_bytes { 0 };
+	uint64_t oversized_datagrams { 0 };
+};
\ No newline at end of file
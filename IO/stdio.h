@@ -32,6 +32,15 @@ struct ConsoleIO : AbstractIO {
 		std::cout.flush();
 	}
 
+	/**
+	 * @copydoc AbstractIO::emergency_write
+	 *
+	 * Goes straight to STDOUT_FILENO; whatever std::cout still buffers is lost.
+	 */
+	bool emergency_write(const char* data, size_t size) noexcept override {
+		return write_fully(STDOUT_FILENO, data, size);
+	}
+
 	/**
 	 * @brief Default constructor.
 	 */
@@ -0,0 +1,154 @@
+/**
+ * @file cclogger_agent.cpp
+ * @brief Out-of-process writer: drains a ShmRing filled by ShmLogger producers, formats and writes the records.
+ *
+ * Usage: cclogger-agent --shm <name> --out <file> [--capacity <bytes>] [--once] [--unlink]
+ *
+ *   --shm       shm_open() name shared with the producers, e.g. /myapp-log
+ *   --out       log file, opened for appending
+ *   --capacity  ring size if the agent creates the ring (default 4 MiB)
+ *   --once      drain what is in the ring and exit, instead of running until SIGINT/SIGTERM
+ *   --unlink    remove the ring name on exit
+ */
+#include "IO/fileio.h"
+#include "cached_queue/shm_ring.h"
+#include "core/logger_tools.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> stop_requested { false };
+
+void on_stop(int) {
+	stop_requested.store(true);
+}
+
+struct AgentConfig {
+	std::string shm_name;
+	std::string out_path;
+	size_t capacity { ShmRing::kDefaultCapacity };
+	bool once { false };
+	bool unlink { false };
+};
+
+bool parse_args(int argc, char** argv, AgentConfig& config) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--shm" && i + 1 < argc) {
+			config.shm_name = argv[++i];
+		} else if (arg == "--out" && i + 1 < argc) {
+			config.out_path = argv[++i];
+		} else if (arg == "--capacity" && i + 1 < argc) {
+			config.capacity = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--once") {
+			config.once = true;
+		} else if (arg == "--unlink") {
+			config.unlink = true;
+		} else {
+			return false;
+		}
+	}
+	return !config.shm_name.empty() && !config.out_path.empty();
+}
+
+/**
+ * @brief Formats one record as "<time> [<pid>:<tid>] <message>".
+ */
+std::string format_entry(LoggerTools& tools, const ShmEntry& entry) {
+	const auto tp = std::chrono::system_clock::time_point(
+	    std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(entry.timestamp_ns)));
+	std::string line = tools.format_time(tp);
+	line.append(" [").append(std::to_string(entry.pid)).append(":").append(std::to_string(entry.tid)).append("] ");
+	line.append(entry.message);
+	if (entry.message.empty() || entry.message.back() != '\n') {
+		line.push_back('\n');
+	}
+	return line;
+}
+
+}
+
+int main(int argc, char** argv) {
+	AgentConfig config;
+	if (!parse_args(argc, argv, config)) {
+		std::cerr << "usage: cclogger-agent --shm <name> --out <file> [--capacity <bytes>] [--once] [--unlink]\n";
+		return 2;
+	}
+
+	std::unique_ptr<ShmRing> ring;
+	try {
+		ring = ShmRing::attach(config.shm_name, config.capacity);
+	} catch (const std::exception& e) {
+		std::cerr << "cclogger-agent: " << e.what() << "\n";
+		return 1;
+	}
+	FileIO out(config.out_path);
+	LoggerTools tools;
+
+	struct sigaction action {};
+	action.sa_handler = &on_stop;
+	sigemptyset(&action.sa_mask);
+	::sigaction(SIGINT, &action, nullptr);
+	::sigaction(SIGTERM, &action, nullptr);
+
+	/* a record claimed but never published for this long means its writer died mid write */
+	constexpr auto kStallTimeout = std::chrono::seconds(2);
+	constexpr auto kMaxIdleSleep = std::chrono::microseconds(1000);
+	auto idle_sleep = std::chrono::microseconds(0);
+	auto stalled_since = std::chrono::steady_clock::time_point {};
+	bool unflushed = false;
+
+	while (true) {
+		const size_t count = ring->read([&](const ShmEntry& entry) { out.write_logger(format_entry(tools, entry)); });
+		if (count > 0) {
+			unflushed = true;
+			idle_sleep = std::chrono::microseconds(0);
+			stalled_since = {};
+			continue;
+		}
+
+		/* idle: persist what we have, then back off */
+		if (unflushed) {
+			out.force_flush();
+			unflushed = false;
+		}
+		const bool behind = ring->read_position() < ring->write_position();
+		if (!behind && (config.once || stop_requested.load())) {
+			break;
+		}
+		if (behind) {
+			const auto now = std::chrono::steady_clock::now();
+			if (stalled_since == std::chrono::steady_clock::time_point {}) {
+				stalled_since = now;
+			} else if (now - stalled_since >= kStallTimeout) {
+				const uint64_t skipped = ring->skip_stalled();
+				out.write_logger("cclogger-agent: skipped " + std::to_string(skipped)
+				                 + " bytes behind a record whose writer never published it\n");
+				unflushed = true;
+				stalled_since = {};
+			}
+		}
+		if (idle_sleep.count() == 0) {
+			std::this_thread::yield();
+			idle_sleep = std::chrono::microseconds(50);
+		} else {
+			std::this_thread::sleep_for(idle_sleep);
+			idle_sleep = std::min(idle_sleep * 2, kMaxIdleSleep);
+		}
+	}
+
+	if (ring->dropped() > 0) {
+		std::cerr << "cclogger-agent: producers dropped " << ring->dropped() << " records on a full ring\n";
+	}
+	if (config.unlink) {
+		ShmRing::unlink(config.shm_name);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,687 @@
+/**
+ * @file cclogger_bench.cpp
+ * @brief Self-contained benchmark suite for CCLogger.
+ *
+ * Every result is printed as one JSON object per line on stdout, so runs can be
+ * diffed between releases or fed to a regression tracker. Human readable
+ * progress goes to stderr.
+ *
+ * Usage: cclogger_bench [--quick] [--filter <substring>]
+ */
+#include "IO/consoleio.h"
+#include "IO/fileio.h"
+#include "IO/io.h"
+#include "IO/stdio.h"
+#include "cached_queue/backtrace_ring.h"
+#include "cached_queue/logger_queue.h"
+#include "core/log_clock.h"
+#include "core/thread_placement.h"
+#include "core/thread_registry.h"
+#include "format/logger_format.h"
+#include "logger/logger.h"
+#include "logger/logger_registry.h"
+#include "logger/shm_logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+#ifdef __OPTIMIZE__
+constexpr bool kOptimized = true;
+#else
+constexpr bool kOptimized = false;
+#endif
+
+/**
+ * @brief Sink that only counts, so logger benchmarks do not measure the disk.
+ */
+struct NullIO : AbstractIO {
+	std::atomic<uint64_t> bytes { 0 };
+	void write_logger(const std::string& msg) override { bytes.fetch_add(msg.size(), std::memory_order_relaxed); }
+	void force_flush() override { }
+};
+
+/**
+ * @brief Collects key/value pairs and prints them as one JSON line.
+ */
+class JsonLine {
+public:
+	explicit JsonLine(std::string_view bench) { oss << "{\"bench\":\"" << bench << "\""; }
+
+	JsonLine& add(std::string_view key, std::string_view value) {
+		oss << ",\"" << key << "\":\"" << value << "\"";
+		return *this;
+	}
+
+	JsonLine& add(std::string_view key, bool value) {
+		oss << ",\"" << key << "\":" << (value ? "true" : "false");
+		return *this;
+	}
+
+	template <typename Number>
+	JsonLine& add(std::string_view key, Number value) {
+		oss << ",\"" << key << "\":" << value;
+		return *this;
+	}
+
+	~JsonLine() { std::cout << oss.str() << "}" << std::endl; }
+
+private:
+	std::ostringstream oss;
+};
+
+struct BenchConfig {
+	bool quick { false };
+	std::string filter;
+	std::vector<int> thread_counts { 1, 2, 4, 8 };
+	std::vector<size_t> message_sizes { 16, 64, 256, 1024 };
+	size_t messages_per_thread { 200000 };
+
+	bool enabled(std::string_view name) const {
+		return filter.empty() || name.find(filter) != std::string_view::npos;
+	}
+};
+
+std::string make_message(size_t size, size_t seq) {
+	std::string msg = "msg " + std::to_string(seq) + " ";
+	msg.resize(std::max(size, msg.size()), 'x');
+	return msg;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+	if (sorted.empty())
+		return 0;
+	const size_t idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+	return sorted[idx];
+}
+
+uint64_t elapsed_ns(bench_clock::time_point from, bench_clock::time_point to) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+/**
+ * @brief Producer latency and end-to-end throughput of CCLogger::push_message.
+ *
+ * Each producer times every single push; end-to-end covers first push until
+ * sync_flush returns, i.e. until the worker has formatted and written all of it.
+ */
+void bench_logger(const BenchConfig& config) {
+	for (int threads : config.thread_counts) {
+		for (size_t size : config.message_sizes) {
+			const size_t per_thread = config.messages_per_thread;
+			auto sink = new NullIO;
+			CCLogger logger(sink);
+			logger.set_formattor(new DefLoggerFormatFactory);
+
+			std::vector<std::vector<uint64_t>> latencies(threads);
+			std::vector<std::thread> producers;
+			std::atomic<int> ready { 0 };
+			std::atomic<bool> go { false };
+			for (int t = 0; t < threads; ++t) {
+				producers.emplace_back([&, t]() {
+					std::vector<std::string> messages;
+					messages.reserve(per_thread);
+					for (size_t i = 0; i < per_thread; ++i)
+						messages.push_back(make_message(size, i));
+					auto& lat = latencies[t];
+					lat.reserve(per_thread);
+					ready.fetch_add(1);
+					while (!go.load())
+						std::this_thread::yield();
+					for (const auto& msg : messages) {
+						const auto begin = bench_clock::now();
+						logger.push_message(msg);
+						lat.push_back(elapsed_ns(begin, bench_clock::now()));
+					}
+				});
+			}
+			while (ready.load() != threads)
+				std::this_thread::yield();
+
+			const auto start = bench_clock::now();
+			go.store(true);
+			for (auto& th : producers)
+				th.join();
+			const auto produced = bench_clock::now();
+			logger.sync_flush();
+			const auto drained = bench_clock::now();
+
+			std::vector<uint64_t> all;
+			all.reserve(per_thread * threads);
+			for (auto& lat : latencies)
+				all.insert(all.end(), lat.begin(), lat.end());
+			std::sort(all.begin(), all.end());
+			const double total = static_cast<double>(all.size());
+			const double mean = std::accumulate(all.begin(), all.end(), 0.0) / total;
+
+			JsonLine("producer_latency")
+			    .add("threads", threads)
+			    .add("msg_size", size)
+			    .add("messages", all.size())
+			    .add("mean_ns", static_cast<uint64_t>(mean))
+			    .add("p50_ns", percentile(all, 0.50))
+			    .add("p99_ns", percentile(all, 0.99))
+			    .add("p999_ns", percentile(all, 0.999))
+			    .add("max_ns", all.empty() ? 0 : all.back())
+			    .add("msgs_per_s", static_cast<uint64_t>(total * 1e9 / elapsed_ns(start, produced)));
+
+			const double e2e_ns = static_cast<double>(elapsed_ns(start, drained));
+			JsonLine("end_to_end")
+			    .add("threads", threads)
+			    .add("msg_size", size)
+			    .add("messages", all.size())
+			    .add("msgs_per_s", static_cast<uint64_t>(total * 1e9 / e2e_ns))
+			    .add("sink_mb_per_s", static_cast<double>(sink->bytes.load()) * 1e3 / e2e_ns);
+		}
+	}
+}
+
+/**
+ * @brief How fast the worker side can take batches out of LoggerQueue.
+ */
+void bench_queue_drain(const BenchConfig& config) {
+	for (size_t size : config.message_sizes) {
+		const size_t count = config.messages_per_thread * 4;
+		LoggerQueue queue;
+		for (size_t i = 0; i < count; ++i)
+			queue.enqueue(make_message(size, i));
+
+		std::vector<LogRecord> batch;
+		size_t bytes = 0;
+		const auto start = bench_clock::now();
+		queue.drain(batch);
+		for (const auto& each : batch)
+			bytes += each.message.size();
+		const double ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+
+		JsonLine("queue_drain")
+		    .add("msg_size", size)
+		    .add("messages", batch.size())
+		    .add("msgs_per_s", static_cast<uint64_t>(batch.size() * 1e9 / ns))
+		    .add("mb_per_s", bytes * 1e3 / ns);
+	}
+}
+
+/**
+ * @brief Formatting cost per message for the bundled formatters.
+ */
+void bench_formatter(const BenchConfig& config) {
+	for (size_t size : config.message_sizes) {
+		const size_t count = config.messages_per_thread;
+		const LogRecord record { .message = make_message(size, 0), .thread_index = ThreadRegistry::current_index() };
+
+		auto run = [&](std::string_view name, LoggerFormatFactory& factory) {
+			size_t bytes = 0;
+			const auto start = bench_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				bytes += factory.format(record).size();
+			const double ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+			JsonLine("formatter")
+			    .add("formatter", name)
+			    .add("msg_size", size)
+			    .add("messages", count)
+			    .add("ns_per_msg", ns / count)
+			    .add("out_bytes", bytes);
+		};
+
+		DummyFormatFactory dummy;
+		run("dummy", dummy);
+		DefLoggerFormatFactory full;
+		run("default", full);
+		DefLoggerFormatFactory bare;
+		bare.set_enable_time(false);
+		bare.set_enable_threadid(false);
+		bare.set_enable_srcLocation(false);
+		run("default_bare", bare);
+	}
+}
+
+/**
+ * @brief Worker throughput with rich lines, formatted on the worker alone or on a FormatPool.
+ *
+ * Four producers push the messages; the figure is end to end, until
+ * sync_flush returns. Only multi-core machines can gain from helpers.
+ */
+void bench_format_pool(const BenchConfig& config) {
+	for (size_t size : config.message_sizes) {
+		for (const size_t helpers : { size_t { 0 }, size_t { 1 }, size_t { 3 } }) {
+			auto sink = new NullIO;
+			CCLogger logger(sink);
+			logger.set_formattor(new DefLoggerFormatFactory);
+			logger.set_format_threads(helpers);
+			const std::string msg = make_message(size, 0);
+
+			const auto start = bench_clock::now();
+			std::vector<std::thread> producers;
+			for (int t = 0; t < 4; ++t) {
+				producers.emplace_back([&]() {
+					for (size_t i = 0; i < config.messages_per_thread; ++i)
+						logger.push_message(msg);
+				});
+			}
+			for (auto& th : producers)
+				th.join();
+			logger.sync_flush();
+			const double ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+			const double total = static_cast<double>(config.messages_per_thread * 4);
+			JsonLine("format_pool")
+			    .add("helpers", helpers)
+			    .add("msg_size", size)
+			    .add("messages", static_cast<uint64_t>(total))
+			    .add("msgs_per_s", static_cast<uint64_t>(total * 1e9 / ns))
+			    .add("sink_mb_per_s", static_cast<double>(sink->bytes.load()) * 1e3 / ns);
+		}
+	}
+}
+
+/**
+ * @brief Producer side timestamp cost of every LogClock source.
+ */
+void bench_clock_source(const BenchConfig& config) {
+	const size_t count = config.messages_per_thread * 10;
+	for (auto wanted : { ClockSource::System, ClockSource::MonotonicCoarse, ClockSource::Tsc }) {
+		const ClockSource used = LogClock::set_source(wanted);
+		uint64_t sink = 0;
+		const auto start = bench_clock::now();
+		for (size_t i = 0; i < count; ++i)
+			sink += LogClock::now().ticks;
+		const double ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+		JsonLine("clock")
+		    .add("source", static_cast<int>(used))
+		    .add("wanted", static_cast<int>(wanted))
+		    .add("ns_per_read", ns / count)
+		    .add("checksum", sink & 0xff);
+	}
+	LogClock::set_source(ClockSource::System);
+}
+
+/**
+ * @brief Raw write bandwidth of FileIO, including the final fsync.
+ */
+void bench_file_sink(const BenchConfig& config) {
+	const char* path = "cclogger_bench_sink.log";
+	for (size_t size : config.message_sizes) {
+		std::remove(path);
+		const size_t count = config.messages_per_thread;
+		std::string line = make_message(size, 0);
+		line.back() = '\n';
+
+		double ns;
+		{
+			FileIO sink(path);
+			const auto start = bench_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				sink.write_logger(line);
+			sink.force_flush();
+			ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+		}
+		JsonLine("sink_file")
+		    .add("msg_size", size)
+		    .add("messages", count)
+		    .add("ns_per_msg", ns / count)
+		    .add("mb_per_s", static_cast<double>(count * line.size()) * 1e3 / ns);
+	}
+	std::remove(path);
+}
+
+/**
+ * @brief ConsoleIO (std::cout) against FastConsoleIO (write/writev), stdout sent to /dev/null.
+ *
+ * Lines carry a "[INFO ]" tag so FastConsoleIO pays for its level detection.
+ */
+void bench_console_sink(const BenchConfig& config) {
+	std::cout.flush();
+	const int saved_stdout = ::dup(STDOUT_FILENO);
+	const int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+	for (size_t size : config.message_sizes) {
+		const size_t count = config.messages_per_thread;
+		std::string line = "[INFO ] : " + make_message(size, 0);
+		line.back() = '\n';
+
+		auto run = [&](AbstractIO& sink) {
+			::dup2(null_fd, STDOUT_FILENO);
+			const auto start = bench_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				sink.write_logger(line);
+			sink.force_flush();
+			const auto ns = static_cast<double>(elapsed_ns(start, bench_clock::now()));
+			::dup2(saved_stdout, STDOUT_FILENO);
+			return ns;
+		};
+		ConsoleIO iostream_sink;
+		const double iostream_ns = run(iostream_sink);
+		FastConsoleIO fast_sink;
+		const double fast_ns = run(fast_sink);
+		JsonLine("sink_console")
+		    .add("msg_size", size)
+		    .add("messages", count)
+		    .add("iostream_ns_per_msg", iostream_ns / count)
+		    .add("fast_ns_per_msg", fast_ns / count)
+		    .add("speedup", iostream_ns / fast_ns);
+	}
+	::close(null_fd);
+	::close(saved_stdout);
+}
+
+/**
+ * @brief Producer p99 of a producer pinned to CPU 0, under different worker placements.
+ *
+ * The producer stands in for a pinned latency-critical thread. With the
+ * default placement the worker may be scheduled on that same CPU and
+ * preempt it; pinning the worker elsewhere (or, on a single CPU, lowering
+ * its priority) keeps it out of the producer's way.
+ */
+void bench_placement(const BenchConfig& config) {
+	const int cpus = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	struct Variant {
+		const char* name;
+		ThreadPlacement placement;
+	};
+	std::vector<Variant> variants;
+	variants.push_back({ "default", {} });
+	if (cpus > 1) {
+		ThreadPlacement apart;
+		apart.cpus = { cpus - 1 };
+		apart.numa_local_memory = true;
+		variants.push_back({ "pinned_apart", apart });
+	}
+	ThreadPlacement shared;
+	shared.cpus = { 0 };
+	variants.push_back({ "pinned_shared", shared });
+	ThreadPlacement polite;
+	polite.sched_policy = SCHED_BATCH;
+	polite.nice = 19;
+	variants.push_back({ "nice19_batch", polite });
+
+	ThreadPlacement producer_placement;
+	producer_placement.cpus = { 0 };
+	const size_t size = 64;
+	for (const auto& variant : variants) {
+		CCLogger logger(new NullIO, {}, variant.placement);
+		logger.set_formattor(new DefLoggerFormatFactory);
+		std::vector<uint64_t> latencies;
+		latencies.reserve(config.messages_per_thread);
+		std::thread producer([&]() {
+			producer_placement.apply_to_current();
+			const std::string msg = make_message(size, 0);
+			for (size_t i = 0; i < config.messages_per_thread; ++i) {
+				const auto begin = bench_clock::now();
+				logger.push_message(msg);
+				latencies.push_back(elapsed_ns(begin, bench_clock::now()));
+			}
+		});
+		producer.join();
+		logger.sync_flush();
+		std::sort(latencies.begin(), latencies.end());
+		JsonLine("placement")
+		    .add("worker", std::string_view(variant.name))
+		    .add("msg_size", size)
+		    .add("messages", latencies.size())
+		    .add("p50_ns", percentile(latencies, 0.50))
+		    .add("p99_ns", percentile(latencies, 0.99))
+		    .add("p999_ns", percentile(latencies, 0.999))
+		    .add("max_ns", latencies.empty() ? 0 : latencies.back());
+	}
+}
+
+/**
+ * @brief Producer latency of a BacktraceRing push against CCLogger::push_message.
+ *
+ * The ring is where a NamedLogger with a backtrace keeps messages below its
+ * level; it must cost less than really logging them.
+ */
+void bench_backtrace(const BenchConfig& config) {
+	for (int threads : config.thread_counts) {
+		for (size_t size : config.message_sizes) {
+			CCLogger logger(new NullIO);
+			BacktraceRing ring(1024);
+			auto measure = [&](auto&& push) {
+				std::vector<std::vector<uint64_t>> latencies(threads);
+				std::vector<std::thread> producers;
+				for (int t = 0; t < threads; ++t) {
+					producers.emplace_back([&, t]() {
+						const std::string msg = make_message(size, t);
+						auto& lat = latencies[t];
+						lat.reserve(config.messages_per_thread);
+						for (size_t i = 0; i < config.messages_per_thread; ++i) {
+							const auto begin = bench_clock::now();
+							push(msg);
+							lat.push_back(elapsed_ns(begin, bench_clock::now()));
+						}
+					});
+				}
+				for (auto& th : producers)
+					th.join();
+				std::vector<uint64_t> all;
+				for (auto& lat : latencies)
+					all.insert(all.end(), lat.begin(), lat.end());
+				std::sort(all.begin(), all.end());
+				return all;
+			};
+			const auto ring_ns = measure([&](const std::string& msg) { ring.push(msg, LogLevel::DEBUG); });
+			const auto queue_ns = measure([&](const std::string& msg) { logger.push_message(msg); });
+			logger.sync_flush();
+			JsonLine("backtrace_push")
+			    .add("threads", threads)
+			    .add("msg_size", size)
+			    .add("messages", ring_ns.size())
+			    .add("ring_p50_ns", percentile(ring_ns, 0.50))
+			    .add("ring_p99_ns", percentile(ring_ns, 0.99))
+			    .add("push_message_p50_ns", percentile(queue_ns, 0.50))
+			    .add("push_message_p99_ns", percentile(queue_ns, 0.99));
+		}
+	}
+}
+
+/**
+ * @brief Producer latency of the copying pushes against push_static() and push_message(std::string&&).
+ *
+ * "copy" builds a named std::string from a literal and pushes it, as callers
+ * of push_message(const std::string&) have to; "long" messages spill.
+ */
+void bench_zero_copy(const BenchConfig& config) {
+	CCLogger logger(new NullIO);
+	const size_t count = config.messages_per_thread;
+	/* prepare runs untimed before each push, e.g. to refill a moved-from message */
+	auto measure = [&](auto&& push, auto&& prepare) {
+		std::vector<uint64_t> lat;
+		lat.reserve(count);
+		for (size_t i = 0; i < count; ++i) {
+			prepare(i);
+			const auto begin = bench_clock::now();
+			push(i);
+			lat.push_back(elapsed_ns(begin, bench_clock::now()));
+		}
+		logger.sync_flush();
+		std::sort(lat.begin(), lat.end());
+		return lat;
+	};
+	const auto unprepared = [](size_t) { };
+	auto report = [&](std::string_view path, const std::vector<uint64_t>& lat) {
+		JsonLine("zero_copy")
+		    .add("path", path)
+		    .add("messages", lat.size())
+		    .add("p50_ns", percentile(lat, 0.50))
+		    .add("p99_ns", percentile(lat, 0.99));
+	};
+	report("literal_copy", measure([&](size_t) {
+		const std::string text("connection accepted on listener");
+		logger.push_message(text);
+	}, unprepared));
+	report("literal_static", measure([&](size_t) { logger.push_static("connection accepted on listener"); }, unprepared));
+	const std::string long_text = make_message(LogMessage::kInlineCapacity * 4, 0);
+	report("long_copy", measure([&](size_t) { logger.push_message(long_text); }, unprepared));
+	/* a small pool refilled between pushes, instead of count copies of long_text up front */
+	std::vector<std::string> texts(64);
+	report("long_moved", measure([&](size_t i) { logger.push_message(std::move(texts[i % texts.size()])); },
+	                             [&](size_t i) { texts[i % texts.size()] = long_text; }));
+}
+
+/**
+ * @brief Producer latency of messages with a costly argument, built eagerly, lazily or on the worker.
+ *
+ * "filtered" logs below the level, where a lazy maker is never called;
+ * "enabled" logs at the level, where on_worker() moves the cost off the producer.
+ */
+void bench_lazy(const BenchConfig& config) {
+	CCLogger logger(new NullIO);
+	LoggerRegistry::set_backend(&logger);
+	NamedLogger& svc = LoggerRegistry::get("bench.lazy");
+	svc.set_level(LogLevel::INFO);
+	const auto values = std::make_shared<const std::vector<int>>(64, 12345);
+	const auto describe = [](const std::vector<int>& all) {
+		std::string text = "values:";
+		for (int value : all)
+			text.append(" ").append(std::to_string(value));
+		return text;
+	};
+	const size_t count = config.messages_per_thread;
+	auto measure = [&](auto&& log) {
+		std::vector<uint64_t> lat;
+		lat.reserve(count);
+		for (size_t i = 0; i < count; ++i) {
+			const auto begin = bench_clock::now();
+			log();
+			lat.push_back(elapsed_ns(begin, bench_clock::now()));
+		}
+		logger.sync_flush();
+		std::sort(lat.begin(), lat.end());
+		return lat;
+	};
+	auto report = [&](std::string_view path, const std::vector<uint64_t>& lat) {
+		JsonLine("lazy")
+		    .add("path", path)
+		    .add("messages", lat.size())
+		    .add("p50_ns", percentile(lat, 0.50))
+		    .add("p99_ns", percentile(lat, 0.99));
+	};
+	report("filtered_eager", measure([&]() { svc.debug(describe(*values)); }));
+	report("filtered_lazy", measure([&]() { svc.debug([&]() { return describe(*values); }); }));
+	report("enabled_caller", measure([&]() { svc.info([&]() { return describe(*values); }); }));
+	report("enabled_on_worker", measure([&]() { svc.info(on_worker([values, describe]() { return describe(*values); })); }));
+	svc.clear_level();
+	LoggerRegistry::set_backend(nullptr);
+}
+
+/**
+ * @brief Producer latency of ShmLogger, with an in-process reader standing in for cclogger-agent.
+ *
+ * Comparable to producer_latency: the same push, minus the queue lock and
+ * the worker wakeup, plus the copy into shared memory.
+ */
+void bench_shm(const BenchConfig& config) {
+	const std::string name = "/cclogger-bench-" + std::to_string(::getpid());
+	for (int threads : config.thread_counts) {
+		for (size_t size : config.message_sizes) {
+			ShmRing::unlink(name);
+			ShmLogger logger(name, 16 * 1024 * 1024);
+			std::atomic<bool> done { false };
+			std::thread reader([&]() {
+				while (!done.load() || logger.get_ring().read_position() < logger.get_ring().write_position())
+					if (logger.get_ring().read([](const ShmEntry&) { }) == 0)
+						std::this_thread::yield();
+			});
+
+			std::vector<std::vector<uint64_t>> latencies(threads);
+			std::vector<std::thread> producers;
+			for (int t = 0; t < threads; ++t) {
+				producers.emplace_back([&, t]() {
+					const std::string msg = make_message(size, t);
+					auto& lat = latencies[t];
+					lat.reserve(config.messages_per_thread);
+					for (size_t i = 0; i < config.messages_per_thread; ++i) {
+						const auto begin = bench_clock::now();
+						logger.push_message(msg);
+						lat.push_back(elapsed_ns(begin, bench_clock::now()));
+					}
+				});
+			}
+			for (auto& th : producers)
+				th.join();
+			done.store(true);
+			reader.join();
+
+			std::vector<uint64_t> all;
+			for (auto& lat : latencies)
+				all.insert(all.end(), lat.begin(), lat.end());
+			std::sort(all.begin(), all.end());
+			JsonLine("shm_producer_latency")
+			    .add("threads", threads)
+			    .add("msg_size", size)
+			    .add("messages", all.size())
+			    .add("dropped", logger.dropped())
+			    .add("p50_ns", percentile(all, 0.50))
+			    .add("p99_ns", percentile(all, 0.99))
+			    .add("p999_ns", percentile(all, 0.999))
+			    .add("max_ns", all.empty() ? 0 : all.back());
+		}
+	}
+	ShmRing::unlink(name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	BenchConfig config;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--quick") == 0) {
+			config.quick = true;
+		} else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			config.filter = argv[++i];
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--quick] [--filter <substring>]\n";
+			return 1;
+		}
+	}
+	if (config.quick) {
+		config.thread_counts = { 1, 4 };
+		config.message_sizes = { 64, 256 };
+		config.messages_per_thread = 20000;
+	}
+
+	JsonLine("meta")
+	    .add("hardware_threads", std::thread::hardware_concurrency())
+	    .add("optimized", kOptimized)
+	    .add("quick", config.quick);
+
+	const struct {
+		const char* name;
+		void (*run)(const BenchConfig&);
+	} suites[] = {
+		{ "logger", bench_logger },
+		{ "queue_drain", bench_queue_drain },
+		{ "formatter", bench_formatter },
+		{ "format_pool", bench_format_pool },
+		{ "clock", bench_clock_source },
+		{ "sink_file", bench_file_sink },
+		{ "sink_console", bench_console_sink },
+		{ "shm", bench_shm },
+		{ "placement", bench_placement },
+		{ "backtrace", bench_backtrace },
+		{ "zero_copy", bench_zero_copy },
+		{ "lazy", bench_lazy },
+	};
+	for (const auto& suite : suites) {
+		if (!config.enabled(suite.name))
+			continue;
+		std::cerr << "running " << suite.name << "...\n";
+		suite.run(config);
+	}
+	return 0;
+}
@@ -0,0 +1,50 @@
+#include "backtrace_ring.h"
+#include <algorithm>
+#include <thread>
+
+BacktraceRing::BacktraceRing(size_t capacity)
+    : slot_count(std::max<size_t>(capacity, 1))
+    , slots(std::make_unique<Slot[]>(slot_count)) { }
+
+void BacktraceRing::lock(Slot& slot) noexcept {
+	while (slot.busy.exchange(true, std::memory_order_acquire)) {
+		/* held for one record copy, unless the holder got preempted */
+		while (slot.busy.load(std::memory_order_relaxed)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void BacktraceRing::push(std::string_view message, LogLevel level, uint16_t logger_id) {
+	const uint64_t position = head.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[position % slot_count];
+	lock(slot);
+	/* a writer a full lap ahead got here first, this record is already overwritten */
+	if (slot.position == UINT64_MAX || slot.position < position) {
+		slot.position = position;
+		slot.record.stamp_now();
+		slot.record.level = level;
+		slot.record.logger_id = logger_id;
+		slot.record.message.assign(message);
+	}
+	slot.busy.store(false, std::memory_order_release);
+}
+
+size_t BacktraceRing::collect(std::vector<LogRecord>& out) {
+	std::lock_guard<std::mutex> guard(collect_locker);
+	const uint64_t end = head.load(std::memory_order_relaxed);
+	const uint64_t begin = std::max(tail, end > slot_count ? end - slot_count : 0);
+	size_t taken = 0;
+	for (uint64_t position = begin; position < end; ++position) {
+		Slot& slot = slots[position % slot_count];
+		lock(slot);
+		/* a writer that claimed the ticket but has not stored yet is skipped */
+		if (slot.position == position) {
+			out.push_back(std::move(slot.record));
+			++taken;
+		}
+		slot.busy.store(false, std::memory_order_release);
+	}
+	tail = end;
+	return taken;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file backtrace_ring.h
+ * @brief Defines BacktraceRing, a fixed-size in-memory ring of recent records that are not written unless dumped.
+ */
+
+#pragma once
+
+#include "log_record.h"
+#include "tools/class_helper.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Keeps the last capacity() records pushed to it, overwriting the oldest.
+ *
+ * Meant for records below the level that is written (DEBUG, TRACE): they
+ * are stamped and copied into a preallocated slot, unformatted, and only
+ * reach the sink if collect() is called, e.g. when an error is logged. A
+ * push is one fetch_add to claim a slot plus an uncontended per-slot spin
+ * lock, so it skips the queue mutex, the worker wakeup and the counters of
+ * CCLogger::push_message().
+ */
+class BacktraceRing {
+public:
+	DISABLE_COPY_MOVE(BacktraceRing);
+	BacktraceRing() = delete;
+
+	/**
+	 * @brief Allocates all slots up front.
+	 *
+	 * @param capacity Records kept, at least 1.
+	 */
+	explicit BacktraceRing(size_t capacity);
+
+	/**
+	 * @brief Stamps a record with the calling thread and the current time and stores it.
+	 *
+	 * @param message The raw message.
+	 * @param level The level it was logged at.
+	 * @param logger_id The LoggerRegistry id of the named logger, 0 for none.
+	 */
+	void push(std::string_view message, LogLevel level, uint16_t logger_id = 0);
+
+	/**
+	 * @brief Moves the records pushed since the last collect() into out, oldest first.
+	 *
+	 * At most capacity() records are returned; older ones were overwritten.
+	 * @param out Receives the records, appended.
+	 * @return How many records were appended.
+	 */
+	size_t collect(std::vector<LogRecord>& out);
+
+	/**
+	 * @brief Records kept at most.
+	 */
+	size_t capacity() const noexcept { return slot_count; }
+
+	/**
+	 * @brief Records pushed since construction, collected or not.
+	 */
+	uint64_t pushed() const noexcept { return head.load(std::memory_order_relaxed); }
+
+private:
+	struct alignas(64) Slot {
+		std::atomic<bool> busy { false }; ///< Spin lock of this slot.
+		uint64_t position { UINT64_MAX }; ///< Ticket of the record held, UINT64_MAX when empty.
+		LogRecord record; ///< The record.
+	};
+
+	/**
+	 * @brief Takes the spin lock of a slot.
+	 */
+	static void lock(Slot& slot) noexcept;
+
+	const size_t slot_count; ///< Number of slots.
+	std::unique_ptr<Slot[]> slots; ///< The ring.
+	std::atomic<uint64_t> head { 0 }; ///< Next ticket to hand out.
+	uint64_t tail { 0 }; ///< First ticket not collected yet, guarded by collect_locker.
+	std::mutex collect_locker; ///< Serializes collect().
+};
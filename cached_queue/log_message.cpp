@@ -0,0 +1,83 @@
+#include "log_message.h"
+#include <array>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMinClassShift = 9; ///< 512 bytes, the smallest pooled buffer.
+constexpr size_t kMaxClassShift = 16; ///< 64 KiB, larger buffers are not pooled.
+constexpr size_t kClassCount = kMaxClassShift - kMinClassShift + 1;
+constexpr size_t kMaxFreePerClass = 64; ///< Buffers kept per class.
+
+struct SizeClass {
+	std::mutex locker;
+	std::vector<char*> free;
+};
+
+/* leaked on purpose: messages may be released while static destructors run */
+std::array<SizeClass, kClassCount>& classes() {
+	static auto* instance = [] {
+		auto* all = new std::array<SizeClass, kClassCount>;
+		for (auto& size_class : *all)
+			size_class.free.reserve(kMaxFreePerClass);
+		return all;
+	}();
+	return *instance;
+}
+
+size_t class_shift(size_t bytes) {
+	const size_t shift = std::bit_width(bytes - 1);
+	return shift < kMinClassShift ? kMinClassShift : shift;
+}
+
+}
+
+char* OverflowPool::acquire(size_t bytes, size_t& capacity) {
+	const size_t shift = class_shift(bytes);
+	if (shift > kMaxClassShift) {
+		capacity = bytes;
+		return new char[bytes];
+	}
+	capacity = size_t { 1 } << shift;
+	auto& size_class = classes()[shift - kMinClassShift];
+	{
+		std::lock_guard<std::mutex> lock(size_class.locker);
+		if (!size_class.free.empty()) {
+			char* buffer = size_class.free.back();
+			size_class.free.pop_back();
+			return buffer;
+		}
+	}
+	return new char[capacity];
+}
+
+void OverflowPool::release(char* buffer, size_t capacity) noexcept {
+	if (buffer == nullptr) {
+		return;
+	}
+	if (std::has_single_bit(capacity)) {
+		const size_t shift = std::bit_width(capacity) - 1;
+		if (shift >= kMinClassShift && shift <= kMaxClassShift) {
+			auto& size_class = classes()[shift - kMinClassShift];
+			std::lock_guard<std::mutex> lock(size_class.locker);
+			if (size_class.free.size() < kMaxFreePerClass) {
+				size_class.free.push_back(buffer);
+				return;
+			}
+		}
+	}
+	delete[] buffer;
+}
+
+char* LogMessage::reserve_spill(size_t bytes) {
+	if (spilled() && spill_capacity != kAdopted && spill_capacity >= bytes) {
+		return spill;
+	}
+	if (spill) {
+		release_spill();
+	}
+	spill = OverflowPool::acquire(bytes, spill_capacity);
+	return spill;
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+/**
+ * @file log_message.h
+ * @brief Defines LogMessage, the message text of a LogRecord stored inline in the queue slot.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Inline payload size of a LogMessage, set with the CCLOGGER_INLINE_PAYLOAD CMake cache variable.
+ */
+#ifndef CCLOGGER_INLINE_PAYLOAD
+#define CCLOGGER_INLINE_PAYLOAD 256
+#endif
+
+/**
+ * @brief Recycles the heap buffers of messages too long to be stored inline.
+ *
+ * Buffers come in power of two size classes; released ones are kept on a
+ * per class free list (bounded), so steady state spills do not hit the
+ * allocator either. Buffers above the largest class go straight to new/delete.
+ */
+class OverflowPool {
+public:
+	/**
+	 * @brief Hands out a buffer of at least bytes.
+	 *
+	 * @param bytes The size needed.
+	 * @param capacity Receives the real size of the buffer, pass it back to release().
+	 * @return The buffer.
+	 */
+	static char* acquire(size_t bytes, size_t& capacity);
+
+	/**
+	 * @brief Returns a buffer obtained from acquire().
+	 *
+	 * @param buffer The buffer.
+	 * @param capacity The capacity acquire() reported.
+	 */
+	static void release(char* buffer, size_t capacity) noexcept;
+};
+
+/**
+ * @brief Text with static storage duration, safe to log by pointer and length.
+ *
+ * Only string literals (and other constant char arrays with static storage)
+ * convert implicitly, checked at compile time by the consteval constructor;
+ * a std::string_view known to outlive the logger needs from_static().
+ */
+class StaticText {
+public:
+	template <size_t N>
+	consteval StaticText(const char (&literal)[N]) noexcept
+	    : text(literal, N - 1) { }
+
+	/**
+	 * @brief Wraps a view the caller promises stays valid until the logger is gone.
+	 */
+	static constexpr StaticText from_static(std::string_view view) noexcept { return StaticText(view); }
+
+	constexpr std::string_view view() const noexcept { return text; }
+
+private:
+	constexpr explicit StaticText(std::string_view view) noexcept
+	    : text(view) { }
+
+	std::string_view text; ///< The text.
+};
+
+/**
+ * @brief A callable that builds message text, e.g. [&] { return describe(obj); }.
+ */
+template <typename F>
+concept TextMaker = std::invocable<F&> && std::constructible_from<std::string, std::invoke_result_t<F&>>;
+
+/**
+ * @brief Type erased text maker kept inside a LogMessage until the worker renders it.
+ */
+class DeferredText {
+public:
+	virtual ~DeferredText() = default;
+	virtual std::string render() = 0; ///< Builds the text.
+	virtual void copy_to(void* storage) const = 0; ///< Copy constructs the maker at storage.
+	virtual void move_to(void* storage) noexcept = 0; ///< Move constructs the maker at storage.
+};
+
+/**
+ * @brief DeferredText holding one maker of type F.
+ */
+template <typename F>
+class DeferredCall final : public DeferredText {
+public:
+	template <typename G>
+	explicit DeferredCall(G&& maker)
+	    : maker(std::forward<G>(maker)) { }
+
+	std::string render() override { return std::string(std::invoke(maker)); }
+	void copy_to(void* storage) const override { ::new (storage) DeferredCall(maker); }
+	void move_to(void* storage) noexcept override { ::new (storage) DeferredCall(std::move(maker)); }
+
+private:
+	F maker; ///< The callable.
+};
+
+/**
+ * @brief A string with a large, configurable inline buffer.
+ *
+ * Messages up to kInlineCapacity bytes live inside the object, and so
+ * directly inside the queue slot; enqueue to write then never touches the
+ * allocator. Longer messages spill transparently to an OverflowPool buffer.
+ * Two modes skip the copy altogether: borrow() keeps only the pointer to a
+ * StaticText, and adopt() takes over the heap buffer of a long std::string.
+ * defer() goes further and stores the callable that builds the text, for
+ * the worker to run with render().
+ */
+class LogMessage {
+public:
+	static constexpr size_t kInlineCapacity = CCLOGGER_INLINE_PAYLOAD; ///< Bytes stored without spilling.
+
+	LogMessage() noexcept = default;
+	LogMessage(std::string_view text) { assign(text); }
+	LogMessage(const char* text) { assign(text); }
+	LogMessage(const std::string& text) { assign(text); }
+
+	LogMessage(const LogMessage& other) { copy(other); }
+	LogMessage(LogMessage&& other) noexcept { steal(other); }
+
+	LogMessage& operator=(const LogMessage& other) {
+		if (this != &other) {
+			copy(other);
+		}
+		return *this;
+	}
+
+	LogMessage& operator=(LogMessage&& other) noexcept {
+		if (this != &other) {
+			reset();
+			steal(other);
+		}
+		return *this;
+	}
+
+	~LogMessage() { reset(); }
+
+	/**
+	 * @brief Points at static text instead of copying it.
+	 *
+	 * @param text The new content.
+	 */
+	void borrow(StaticText text) noexcept {
+		reset();
+		spill = const_cast<char*>(text.view().data());
+		spill_capacity = kBorrowed;
+		length = text.view().size();
+	}
+
+	/**
+	 * @brief Takes over a string's heap buffer when it would spill, copies it inline otherwise.
+	 *
+	 * @param text The new content, left empty or unspecified.
+	 */
+	void adopt(std::string&& text) {
+		if constexpr (sizeof(std::string) <= kInlineCapacity) {
+			if (text.size() > kInlineCapacity) {
+				reset();
+				/* the string object lives in the unused inline buffer, its long buffer stays put */
+				spill = (::new (inline_buffer) std::string(std::move(text)))->data();
+				spill_capacity = kAdopted;
+				length = adopted().size();
+				return;
+			}
+		}
+		assign(text);
+	}
+
+	/**
+	 * @brief Whether defer() can keep a maker of type F, instead of running it at once.
+	 *
+	 * The maker must fit the inline buffer, and be copyable (LoggerQueue::current_left()
+	 * copies records) and nothrow movable (records move between slots).
+	 */
+	template <typename F>
+	static constexpr bool kDeferrable = sizeof(DeferredCall<F>) <= kInlineCapacity
+	    && alignof(DeferredCall<F>) <= alignof(std::string) && std::copy_constructible<F>
+	    && std::is_nothrow_move_constructible_v<F>;
+
+	/**
+	 * @brief Stores a text maker to be run later by render(), on whichever thread renders.
+	 *
+	 * Until rendered the message is empty. A maker that is not kDeferrable
+	 * runs right away and its text is adopted.
+	 * @param maker The callable, copied or moved into the message; it must
+	 *        not refer to anything that may be gone by the time it runs.
+	 */
+	template <TextMaker F>
+	void defer(F&& maker) {
+		using Call = DeferredCall<std::decay_t<F>>;
+		if constexpr (kDeferrable<std::decay_t<F>>) {
+			reset();
+			::new (inline_buffer) Call(std::forward<F>(maker));
+			spill = inline_buffer;
+			spill_capacity = kDeferred;
+		} else {
+			adopt(std::string(std::invoke(maker)));
+		}
+	}
+
+	/**
+	 * @brief Runs a deferred maker and keeps its text, does nothing for other messages.
+	 *
+	 * A maker that throws leaves a note with the exception's message instead.
+	 */
+	void render() {
+		if (!deferred()) {
+			return;
+		}
+		std::string text;
+		try {
+			text = deferred_call().render();
+		} catch (const std::exception& e) {
+			text = std::string("<log message threw: ") + e.what() + ">";
+		} catch (...) {
+			text = "<log message threw>";
+		}
+		release_spill();
+		adopt(std::move(text));
+	}
+
+	/**
+	 * @brief Replaces the content, spilling to the pool only when text does not fit inline.
+	 *
+	 * @param text The new content.
+	 */
+	CCLOGGER_HOT_INLINE void assign(std::string_view text) {
+		char* target = inline_buffer;
+		if (text.size() > kInlineCapacity) [[unlikely]] {
+			target = reserve_spill(text.size());
+		} else if (spill) {
+			release_spill();
+		}
+		std::memcpy(target, text.data(), text.size());
+		length = text.size();
+	}
+
+	const char* data() const noexcept { return spill ? spill : inline_buffer; }
+	size_t size() const noexcept { return length; }
+	bool empty() const noexcept { return length == 0; }
+	bool spilled() const noexcept { return spill != nullptr && spill_capacity != kBorrowed && !deferred(); } ///< Content on the heap.
+	bool borrowed() const noexcept { return spill != nullptr && spill_capacity == kBorrowed; } ///< Content is static text.
+	bool deferred() const noexcept { return spill_capacity == kDeferred; } ///< Content is a maker awaiting render().
+
+	std::string_view view() const noexcept { return { data(), length }; }
+	operator std::string_view() const noexcept { return view(); }
+	std::string str() const { return std::string(view()); }
+
+	friend bool operator==(const LogMessage& lhs, std::string_view rhs) noexcept { return lhs.view() == rhs; }
+
+private:
+	static constexpr size_t kBorrowed = 0; ///< spill_capacity when spill is borrowed static text.
+	static constexpr size_t kAdopted = SIZE_MAX; ///< spill_capacity when spill belongs to the std::string in inline_buffer.
+	static constexpr size_t kDeferred = SIZE_MAX - 1; ///< spill_capacity when inline_buffer holds a DeferredText, length is 0.
+
+	std::string& adopted() noexcept { return *std::launder(reinterpret_cast<std::string*>(inline_buffer)); }
+	DeferredText& deferred_call() noexcept { return *std::launder(reinterpret_cast<DeferredText*>(inline_buffer)); }
+	const DeferredText& deferred_call() const noexcept { return *std::launder(reinterpret_cast<const DeferredText*>(inline_buffer)); }
+
+	void copy(const LogMessage& other) {
+		if (other.deferred()) {
+			reset();
+			other.deferred_call().copy_to(inline_buffer);
+			spill = inline_buffer;
+			spill_capacity = kDeferred;
+		} else if (other.borrowed()) {
+			borrow(StaticText::from_static(other.view()));
+		} else {
+			assign(other.view());
+		}
+	}
+
+	/**
+	 * @brief Makes the spill buffer hold at least bytes, reusing the current one when big enough.
+	 */
+	char* reserve_spill(size_t bytes);
+
+	void release_spill() noexcept {
+		if (spill_capacity == kAdopted) {
+			adopted().~basic_string();
+		} else if (spill_capacity == kDeferred) {
+			deferred_call().~DeferredText();
+		} else if (spill_capacity != kBorrowed) {
+			OverflowPool::release(spill, spill_capacity);
+		}
+		spill = nullptr;
+		spill_capacity = 0;
+	}
+
+	void reset() noexcept {
+		if (spill) {
+			release_spill();
+		}
+		length = 0;
+	}
+
+	void steal(LogMessage& other) noexcept {
+		if (other.spill_capacity == kAdopted) {
+			::new (inline_buffer) std::string(std::move(other.adopted()));
+			other.release_spill();
+			spill = adopted().data();
+			spill_capacity = kAdopted;
+		} else if (other.spill_capacity == kDeferred) {
+			other.deferred_call().move_to(inline_buffer);
+			other.release_spill();
+			spill = inline_buffer;
+			spill_capacity = kDeferred;
+		} else if (other.spill) {
+			spill = other.spill;
+			spill_capacity = other.spill_capacity;
+			other.spill = nullptr;
+			other.spill_capacity = 0;
+		} else {
+			std::memcpy(inline_buffer, other.inline_buffer, other.length);
+		}
+		length = other.length;
+		other.length = 0;
+	}
+
+	size_t length { 0 }; ///< Bytes in use.
+	char* spill { nullptr }; ///< Pool buffer when the content does not fit inline.
+	size_t spill_capacity { 0 }; ///< Size of spill.
+	alignas(std::string) char inline_buffer[kInlineCapacity]; ///< Inline storage, only the first length bytes are meaningful.
+};
\ No newline at end of file
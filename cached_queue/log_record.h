@@ -0,0 +1,61 @@
+/**
+ * @file log_record.h
+ * @brief Defines LogRecord, the unit LoggerQueue carries from producers to the worker.
+ */
+
+#pragma once
+
+#include "core/log_clock.h"
+#include "core/log_context.h"
+#include "core/logger_tools.h"
+#include "core/thread_registry.h"
+#include "log_message.h"
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief One log message plus what the producer knew when pushing it.
+ *
+ * Everything the formatter needs from the producing thread is captured
+ * here as plain data, so formatting can happen later on the worker. The
+ * message is stored inline (see LogMessage), so a record is a fixed-size
+ * queue slot that normally owns no heap memory.
+ */
+struct LogRecord {
+	LogMessage message {}; ///< The raw message.
+	uint32_t thread_index { 0 }; ///< ThreadRegistry index of the producing thread.
+	ClockSource clock { ClockSource::System }; ///< Source timestamp was read from.
+	LogLevel level { LogLevel::OFF }; ///< Level the message was logged at, OFF when the producer gave none.
+	uint16_t logger_id { 0 }; ///< LoggerRegistry id of the named logger it came from, 0 for none.
+	float sample_rate { 1.0f }; ///< Probability the message was sampled with (see Sampler), 1 when not sampled.
+	uint64_t timestamp { 0 }; ///< Raw LogClock ticks taken at push time.
+	LogContext::Ref context {}; ///< The producer's LogScope fields, empty outside any scope.
+
+	/**
+	 * @brief Builds a record stamped with the calling thread and the current time.
+	 *
+	 * @param message The raw message.
+	 */
+	static CCLOGGER_HOT_INLINE LogRecord capture(std::string_view message) {
+		LogRecord record;
+		record.stamp_now();
+		record.message.assign(message);
+		return record;
+	}
+
+	/**
+	 * @brief Stamps the record with the calling thread, its LogScope context and the current time.
+	 */
+	CCLOGGER_HOT_INLINE void stamp_now() noexcept {
+		const LogClock::Stamp now = LogClock::now();
+		thread_index = ThreadRegistry::current_index();
+		context = LogContext::current();
+		clock = now.source;
+		timestamp = now.ticks;
+	}
+
+	/**
+	 * @brief The timestamp as a LogClock stamp, for LogClock::to_system().
+	 */
+	LogClock::Stamp stamp() const noexcept { return { timestamp, clock }; }
+};
\ No newline at end of file
@@ -1,43 +1,138 @@
 #include "logger_queue.h"
+#include "core/thread_placement.h"
+#include <ctime>
 #include <mutex>
+#include <sched.h>
 #include <stdexcept>
 
-void LoggerQueue::enqueue(const std::string& s) {
+size_t LoggerQueue::enqueue(const LogRecord& r) {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	queue.push_back(s);
+	queue.push_back(r);
+	count.store(queue.size() - head);
+	return queue.size() - head;
 }
 
-void LoggerQueue::enqueue(std::string&& s) {
+size_t LoggerQueue::enqueue(LogRecord&& r) {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	queue.push_back(std::move(s));
+	queue.push_back(std::move(r));
+	count.store(queue.size() - head);
+	return queue.size() - head;
 }
 
-std::string LoggerQueue::dequeue() {
+size_t LoggerQueue::enqueue(std::string_view s, LogLevel level, uint16_t logger_id) {
+	if (s.size() > LogMessage::kInlineCapacity) {
+		/* take the pool buffer outside the lock, moving it in is just a pointer */
+		LogRecord record = LogRecord::capture(s);
+		record.level = level;
+		record.logger_id = logger_id;
+		return enqueue(std::move(record));
+	}
+	return emplace_stamped(level, logger_id, [s](LogMessage& message) { message.assign(s); });
+}
+
+size_t LoggerQueue::enqueue_static(StaticText s, LogLevel level, uint16_t logger_id) {
+	return emplace_stamped(level, logger_id, [s](LogMessage& message) { message.borrow(s); });
+}
+
+template <typename Fill>
+size_t LoggerQueue::emplace_stamped(LogLevel level, uint16_t logger_id, Fill&& fill) {
+	const uint32_t thread_index = ThreadRegistry::current_index();
+	const LogClock::Stamp now = LogClock::now();
+	LogContext::Ref context = LogContext::current();
+
+	std::lock_guard<std::mutex> locker(this->locker_mutex);
+	LogRecord& slot = queue.emplace_back();
+	slot.thread_index = thread_index;
+	slot.clock = now.source;
+	slot.timestamp = now.ticks;
+	slot.level = level;
+	slot.logger_id = logger_id;
+	slot.context = std::move(context);
+	fill(slot.message);
+	count.store(queue.size() - head);
+	return queue.size() - head;
+}
+
+LogRecord LoggerQueue::dequeue() {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	if (queue.empty()) {
+	if (head == queue.size()) {
 		throw std::runtime_error("Dequeue empty!");
 	}
-	auto result = std::move(queue.front());
-	queue.pop_front();
+	auto result = std::move(queue[head++]);
+	if (head == queue.size()) {
+		queue.clear();
+		head = 0;
+	}
+	count.store(queue.size() - head);
 	return result;
 }
 
-std::vector<std::string> LoggerQueue::current_left() {
-	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	return { queue.begin(), queue.end() };
+std::vector<LogRecord> LoggerQueue::current_left() {
+	std::vector<LogRecord> left;
+	{
+		std::lock_guard<std::mutex> locker(this->locker_mutex);
+		left.assign(queue.begin() + head, queue.end());
+	}
+	/* the copies carry their own makers, rendering them leaves the queued records deferred */
+	for (auto& record : left) {
+		record.message.render();
+	}
+	return left;
 }
 
 void LoggerQueue::clear() {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
 	queue.clear();
+	head = 0;
+	count.store(0);
+}
+
+void LoggerQueue::drain(std::vector<LogRecord>& out) {
+	out.clear();
+	std::lock_guard<std::mutex> locker(this->locker_mutex);
+	if (head != 0) {
+		queue.erase(queue.begin(), queue.begin() + head);
+		head = 0;
+	}
+	out.swap(queue);
+	count.store(0);
 }
 
 size_t LoggerQueue::size() {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	return queue.size();
+	return queue.size() - head;
 }
 
 bool LoggerQueue::empty() {
 	std::lock_guard<std::mutex> locker(this->locker_mutex);
-	return queue.empty();
+	return head == queue.size();
+}
+
+bool LoggerQueue::emergency_visit(void (*visit)(const LogRecord&, void*), void* context, uint64_t deadline_ns) noexcept {
+	while (!locker_mutex.try_lock()) {
+		timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC, &ts);
+		if (static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec) >= deadline_ns) {
+			return false;
+		}
+		::sched_yield();
+	}
+	for (size_t i = head; i < queue.size(); ++i) {
+		visit(queue[i], context);
+	}
+	locker_mutex.unlock();
+	return true;
+}
+
+void LoggerQueue::reserve(size_t slots, int numa_node) {
+	std::lock_guard<std::mutex> locker(this->locker_mutex);
+	reserve_slots(queue, slots + head, numa_node);
+}
+
+void LoggerQueue::reserve_slots(std::vector<LogRecord>& records, size_t slots, int numa_node) {
+	records.reserve(slots);
+	/* slots beyond size() are untouched pages, they land on the node once first written */
+	if (numa_node >= 0) {
+		ThreadPlacement::prefer_numa_node(records.data(), records.capacity() * sizeof(LogRecord), numa_node);
+	}
 }
\ No newline at end of file
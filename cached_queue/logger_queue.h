@@ -1,9 +1,11 @@
 #pragma once
+#include "log_record.h"
 #include "tools/class_helper.h"
+#include <atomic>
 #include <cstddef>
-#include <deque>
+#include <cstdint>
 #include <mutex>
-#include <string>
+#include <string_view>
 #include <vector>
 class LoggerQueue {
 public:
@@ -12,26 +14,53 @@ public:
 	LoggerQueue() = default;
 	~LoggerQueue() = default;
 	/**
-	 * @brief enqueue pushes a queue into the logger
+	 * @brief enqueue pushes a record into the logger
+	 *
+	 * @param r the record waiting for enlogger
+	 * @return size_t how many messages are pending after this one
+	 */
+	size_t enqueue(const LogRecord& r);
+	size_t enqueue(LogRecord&& r);
+
+	/**
+	 * @brief enqueue a bare message as a record of the calling thread,
+	 *        built right inside its queue slot
 	 *
 	 * @param s the message waiting for enlogger
+	 * @param level the level it was logged at, OFF for none
+	 * @param logger_id the named logger it came from, 0 for none
+	 * @return size_t how many messages are pending after this one
+	 */
+	size_t enqueue(std::string_view s, LogLevel level = LogLevel::OFF, uint16_t logger_id = 0);
+
+	/**
+	 * @brief enqueue static text by pointer and length, nothing is copied
+	 *
+	 * @param s the message, a literal or StaticText::from_static()
+	 * @param level the level it was logged at, OFF for none
+	 * @param logger_id the named logger it came from, 0 for none
+	 * @return size_t how many messages are pending after this one
 	 */
-	void enqueue(const std::string& s);
-	void enqueue(std::string&& s);
+	size_t enqueue_static(StaticText s, LogLevel level = LogLevel::OFF, uint16_t logger_id = 0);
 	/**
 	 * @brief   dequeue pop the first message out,
 	 *          expectedly, it should be flushed into the files
 	 *
-	 * @return std::string the message should be loggers
+	 * @return LogRecord the record should be loggers
 	 */
-	std::string dequeue();
+	LogRecord dequeue();
 	/**
 	 * @brief   heavy invoke, this interfaces will returns
 	 *          the copy of the left
 	 *
-	 * @return std::vector<std::string>
+	 *          producers wait while it copies, for live inspection of
+	 *          what was written use CCLogger::enable_tail() instead.
+	 *          Deferred messages are rendered in the copies, on the
+	 *          calling thread
+	 *
+	 * @return std::vector<LogRecord>
 	 */
-	std::vector<std::string> current_left();
+	std::vector<LogRecord> current_left();
 
 	/**
 	 * @brief   heavy invoke, this shell clear the everything out and
@@ -39,6 +68,48 @@ public:
 	 */
 	void clear();
 
+	/**
+	 * @brief   move everything pending into out in one locked swap,
+	 *          so nothing enqueued in between can get lost. the queue
+	 *          keeps out's old slots, so pass the same vector every time
+	 *          and neither side allocates once both have grown
+	 *
+	 * @param out receives the pending messages, its old content is dropped
+	 */
+	void drain(std::vector<LogRecord>& out);
+
+	/**
+	 * @brief   crash path: walks the pending records without taking them
+	 *          out. the lock is only ever try_lock'ed, so this gives up
+	 *          instead of deadlocking when e.g. the crashing thread
+	 *          itself holds it. async-signal-safe as far as visit is
+	 *
+	 * @param visit called for each pending record, oldest first
+	 * @param context handed through to visit
+	 * @param deadline_ns CLOCK_MONOTONIC time to give up at
+	 * @return true if the lock was taken and the records visited
+	 */
+	bool emergency_visit(void (*visit)(const LogRecord&, void*), void* context, uint64_t deadline_ns) noexcept;
+
+	/**
+	 * @brief   grow the slot storage up front, optionally placing it on
+	 *          a NUMA node. pass the drain() vector through
+	 *          reserve_slots() as well, the two swap storage on drain
+	 *
+	 * @param slots the slot count to reserve
+	 * @param numa_node the node to place the slots on, -1 for no preference
+	 */
+	void reserve(size_t slots, int numa_node = -1);
+
+	/**
+	 * @brief   the reserve() of a drain() vector
+	 *
+	 * @param records the vector handed to drain()
+	 * @param slots the slot count to reserve
+	 * @param numa_node the node to place the slots on, -1 for no preference
+	 */
+	static void reserve_slots(std::vector<LogRecord>& records, size_t slots, int numa_node = -1);
+
 	/**
 	 * @brief fetch how many messages are left
 	 *
@@ -54,7 +125,24 @@ public:
 	 */
 	bool empty();
 
+	/**
+	 * @brief lock free peek of the pending count, may be stale
+	 *        by the time the caller looks at it
+	 *
+	 * @return size_t the size at the last modification
+	 */
+	CCLOGGER_HOT_INLINE size_t approx_size() const noexcept { return count.load(); }
+
 private:
+	/**
+	 * @brief stamps a new slot with the calling thread and time under the lock,
+	 *        fill sets its message
+	 */
+	template <typename Fill>
+	size_t emplace_stamped(LogLevel level, uint16_t logger_id, Fill&& fill);
+
 	std::mutex locker_mutex;
-	std::deque<std::string> queue;
+	std::vector<LogRecord> queue; ///< record slots, reused across drains
+	size_t head { 0 }; ///< first slot not taken by dequeue() yet
+	std::atomic<size_t> count { 0 }; ///< mirrors queue.size(), readable without the lock
 };
@@ -0,0 +1,248 @@
+#include "shm_ring.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @brief Control block at the start of the segment. Cursors only grow, offsets are cursor & (capacity - 1).
+ */
+struct ShmRing::Header {
+	uint64_t magic; ///< kMagic once the creator finished initializing.
+	uint32_t version; ///< Layout version, kVersion.
+	uint32_t record_align; ///< Record alignment the writers use.
+	uint64_t capacity; ///< Data bytes, a power of two.
+	std::atomic<uint32_t> ready; ///< Set last by the creator.
+	alignas(64) std::atomic<uint64_t> write_pos; ///< Claimed by writers.
+	alignas(64) std::atomic<uint64_t> read_pos; ///< Consumed by the reader.
+	alignas(64) std::atomic<uint64_t> dropped; ///< Records refused because the ring was full.
+};
+
+/**
+ * @brief Precedes every record in the ring; its space is zero until a writer claims it.
+ */
+struct ShmRing::RecordHeader {
+	std::atomic<uint32_t> state; ///< kFree, then kRecord or kPadding once published.
+	uint32_t size; ///< Bytes of the whole slot, header included.
+	uint32_t pid;
+	uint32_t tid;
+	uint64_t timestamp_ns;
+	uint32_t length; ///< Message bytes following the header.
+	uint32_t reserved;
+};
+
+namespace {
+
+constexpr uint64_t kMagic = 0x43434c4f47524e47ull; ///< "CCLOGRNG"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kFree = 0;
+constexpr uint32_t kRecord = 1;
+constexpr uint32_t kPadding = 2;
+constexpr size_t kHeaderBytes = 256; ///< Space reserved for ShmRing::Header, keeps data aligned.
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "ShmRing needs address free atomics");
+
+}
+
+ShmRing::ShmRing(void* mapping, size_t mapped_size)
+    : header(static_cast<Header*>(mapping))
+    , data(static_cast<char*>(mapping) + kHeaderBytes)
+    , data_capacity(mapped_size - kHeaderBytes)
+    , mapped_size(mapped_size) {
+	static_assert(sizeof(RecordHeader) == 32, "records are aligned to their header size");
+	static_assert(sizeof(Header) <= kHeaderBytes);
+}
+
+ShmRing::~ShmRing() {
+	::munmap(header, mapped_size);
+}
+
+std::unique_ptr<ShmRing> ShmRing::attach(const std::string& name, size_t capacity) {
+	capacity = std::bit_ceil(std::max<size_t>(capacity, 4096));
+	bool creator = true;
+	int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0 && errno == EEXIST) {
+		creator = false;
+		fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+	}
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+	}
+
+	size_t mapped_size = kHeaderBytes + capacity;
+	if (creator) {
+		if (::ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+			const int error = errno;
+			::close(fd);
+			::shm_unlink(name.c_str());
+			throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+		}
+	} else {
+		/* the creator may still be sizing the segment */
+		struct stat info {};
+		for (int i = 0; i < 1000 && ::fstat(fd, &info) == 0 && info.st_size == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		mapped_size = static_cast<size_t>(info.st_size);
+		if (mapped_size <= kHeaderBytes || !std::has_single_bit(mapped_size - kHeaderBytes)) {
+			::close(fd);
+			throw std::runtime_error("shm segment " + name + " is not a CCLogger ring");
+		}
+	}
+
+	void* mapping = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	const int error = errno;
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::system_error(error, std::generic_category(), "mmap " + name);
+	}
+
+	std::unique_ptr<ShmRing> ring(new ShmRing(mapping, mapped_size));
+	Header* header = ring->header;
+	if (creator) {
+		/* ftruncate zero filled everything, the cursors and record states included */
+		header->magic = kMagic;
+		header->version = kVersion;
+		header->record_align = sizeof(RecordHeader);
+		header->capacity = ring->data_capacity;
+		header->ready.store(1, std::memory_order_release);
+	} else {
+		for (int i = 0; i < 1000 && header->ready.load(std::memory_order_acquire) == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (header->ready.load(std::memory_order_acquire) == 0 || header->magic != kMagic
+		    || header->version != kVersion || header->capacity != ring->data_capacity) {
+			throw std::runtime_error("shm segment " + name + " is not a compatible CCLogger ring");
+		}
+	}
+	return ring;
+}
+
+void ShmRing::unlink(const std::string& name) noexcept {
+	::shm_unlink(name.c_str());
+}
+
+ShmRing::RecordHeader* ShmRing::record_at(uint64_t position) const noexcept {
+	return reinterpret_cast<RecordHeader*>(data + (position & (data_capacity - 1)));
+}
+
+bool ShmRing::try_write(std::string_view message, uint32_t pid, uint32_t tid, uint64_t timestamp_ns) noexcept {
+	constexpr size_t align = sizeof(RecordHeader);
+	const size_t need = (sizeof(RecordHeader) + message.size() + align - 1) & ~(align - 1);
+	if (need > data_capacity / 2) {
+		header->dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint64_t position = header->write_pos.load(std::memory_order_relaxed);
+	uint64_t padding;
+	while (true) {
+		/* a record never wraps: if it does not fit before the end, pad up to it */
+		const uint64_t offset = position & (data_capacity - 1);
+		padding = offset + need > data_capacity ? data_capacity - offset : 0;
+		const uint64_t end = position + padding + need;
+		if (end - header->read_pos.load(std::memory_order_acquire) > data_capacity) {
+			header->dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (header->write_pos.compare_exchange_weak(position, end, std::memory_order_relaxed)) {
+			break;
+		}
+	}
+
+	if (padding) {
+		RecordHeader* pad = record_at(position);
+		pad->size = static_cast<uint32_t>(padding);
+		pad->state.store(kPadding, std::memory_order_release);
+		position += padding;
+	}
+	RecordHeader* record = record_at(position);
+	record->size = static_cast<uint32_t>(need);
+	record->pid = pid;
+	record->tid = tid;
+	record->timestamp_ns = timestamp_ns;
+	record->length = static_cast<uint32_t>(message.size());
+	std::memcpy(static_cast<void*>(record + 1), message.data(), message.size());
+	record->state.store(kRecord, std::memory_order_release);
+	return true;
+}
+
+size_t ShmRing::read_records(void (*visit)(const ShmEntry&, void*), void* context, size_t max_records) {
+	uint64_t position = header->read_pos.load(std::memory_order_relaxed);
+	const uint64_t end = header->write_pos.load(std::memory_order_acquire);
+	size_t consumed = 0;
+	while (position < end && consumed < max_records) {
+		RecordHeader* record = record_at(position);
+		const uint32_t state = record->state.load(std::memory_order_acquire);
+		if (state == kFree) {
+			break;
+		}
+		const uint32_t size = record->size;
+		/* a crashed or corrupt writer must not make the reader spin, or touch memory outside the slot */
+		if ((state != kRecord && state != kPadding) || size < sizeof(RecordHeader) || size % sizeof(RecordHeader) != 0
+		    || (position & (data_capacity - 1)) + size > data_capacity || position + size > end
+		    || (state == kRecord && record->length > size - sizeof(RecordHeader))) [[unlikely]] {
+			header->read_pos.store(position, std::memory_order_release);
+			skip_stalled();
+			return consumed;
+		}
+		if (state == kRecord) {
+			ShmEntry entry;
+			entry.pid = record->pid;
+			entry.tid = record->tid;
+			entry.timestamp_ns = record->timestamp_ns;
+			entry.message = std::string_view(reinterpret_cast<const char*>(record + 1), record->length);
+			visit(entry, context);
+			++consumed;
+		}
+		/* zero the whole slot: later records may put their header anywhere inside it */
+		std::memset(static_cast<void*>(record), 0, size);
+		position += size;
+	}
+	header->read_pos.store(position, std::memory_order_release);
+	return consumed;
+}
+
+uint64_t ShmRing::skip_stalled() noexcept {
+	const uint64_t from = header->read_pos.load(std::memory_order_relaxed);
+	const uint64_t to = header->write_pos.load(std::memory_order_acquire);
+	for (uint64_t position = from; position < to;) {
+		const uint64_t offset = position & (data_capacity - 1);
+		const uint64_t chunk = std::min<uint64_t>(to - position, data_capacity - offset);
+		std::memset(data + offset, 0, chunk);
+		position += chunk;
+	}
+	header->read_pos.store(to, std::memory_order_release);
+	return to - from;
+}
+
+bool ShmRing::wait_consumed(uint64_t position, std::chrono::milliseconds timeout) const {
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (header->read_pos.load(std::memory_order_acquire) < position) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+	return true;
+}
+
+uint64_t ShmRing::write_position() const noexcept {
+	return header->write_pos.load(std::memory_order_acquire);
+}
+
+uint64_t ShmRing::read_position() const noexcept {
+	return header->read_pos.load(std::memory_order_acquire);
+}
+
+uint64_t ShmRing::dropped() const noexcept {
+	return header->dropped.load(std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+/**
+ * @file shm_ring.h
+ * @brief Defines ShmRing, a multi-producer single-consumer ring of log records in POSIX shared memory.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief One record read back from a ShmRing.
+ */
+struct ShmEntry {
+	uint32_t pid { 0 }; ///< Process that wrote the record.
+	uint32_t tid { 0 }; ///< Kernel thread id of the writer.
+	uint64_t timestamp_ns { 0 }; ///< system_clock nanoseconds since the epoch, taken by the writer.
+	std::string_view message; ///< Points into the ring, only valid inside the read() callback.
+};
+
+/**
+ * @brief A byte ring in a shm_open() segment, shared by writer processes and one reader.
+ *
+ * Writers claim space with a single CAS on the write cursor, copy the record
+ * in and publish it with a release store, so a writer never blocks and never
+ * calls into the kernel. When the ring is full the record is dropped and
+ * counted instead. The reader (normally the cclogger-agent process) consumes
+ * records in claim order and zeroes their space before handing it back.
+ *
+ * Records live in the segment, not in the writer, so whatever a writer
+ * published survives the writer crashing.
+ */
+class ShmRing {
+public:
+	DISABLE_COPY_MOVE(ShmRing);
+	~ShmRing();
+
+	/**
+	 * @brief Opens the ring called name, creating it with capacity bytes if it does not exist yet.
+	 *
+	 * Both sides call this, whichever comes first creates the segment.
+	 * @param name The shm_open() name, e.g. "/myapp-log".
+	 * @param capacity Data bytes, rounded up to a power of two; ignored when the ring exists.
+	 * @throw std::system_error If the segment cannot be created or mapped.
+	 * @throw std::runtime_error If an existing segment is not a compatible ring.
+	 */
+	static std::unique_ptr<ShmRing> attach(const std::string& name, size_t capacity = kDefaultCapacity);
+
+	/**
+	 * @brief Removes the name, mappings stay valid until they are closed.
+	 * @param name The shm_open() name.
+	 */
+	static void unlink(const std::string& name) noexcept;
+
+	/**
+	 * @brief Writer side: appends one record, wait-free apart from CAS retries between writers.
+	 *
+	 * @param message The record text.
+	 * @param pid Writer process.
+	 * @param tid Writer thread.
+	 * @param timestamp_ns Writer time, system_clock nanoseconds.
+	 * @return false if the ring is full (or message larger than half of it), the record is dropped.
+	 */
+	bool try_write(std::string_view message, uint32_t pid, uint32_t tid, uint64_t timestamp_ns) noexcept;
+
+	/**
+	 * @brief Reader side: consumes published records in order.
+	 *
+	 * Stops at the first record claimed but not yet published. A record
+	 * whose header does not describe a slot inside the claimed space (a
+	 * writer that crashed mid-write or scribbled over the ring) is not
+	 * visited: everything claimed from there on is dropped with
+	 * skip_stalled(). Only one reader may call this at a time.
+	 * @param visit Called for each record.
+	 * @param max_records Upper bound of records consumed by this call.
+	 * @return The number of records consumed (padding not counted).
+	 */
+	template <typename Visit>
+	size_t read(Visit&& visit, size_t max_records = SIZE_MAX) {
+		using Target = std::remove_reference_t<Visit>;
+		return read_records(
+		    [](const ShmEntry& entry, void* context) { (*static_cast<Target*>(context))(entry); },
+		    &visit, max_records);
+	}
+
+	/**
+	 * @brief Reader side: drops everything claimed so far, including unpublished records.
+	 *
+	 * For a reader stuck behind a record whose writer died between claiming
+	 * and publishing it. A writer that is merely slow would have its record
+	 * overwritten, so only call this after a generous timeout.
+	 * @return Bytes skipped.
+	 */
+	uint64_t skip_stalled() noexcept;
+
+	/**
+	 * @brief Waits until the reader consumed everything claimed before position.
+	 *
+	 * @param position A write_position() value.
+	 * @param timeout Gives up after this long, e.g. when no reader runs.
+	 * @return Whether the reader got there.
+	 */
+	bool wait_consumed(uint64_t position, std::chrono::milliseconds timeout) const;
+
+	uint64_t write_position() const noexcept; ///< Bytes claimed by writers so far.
+	uint64_t read_position() const noexcept; ///< Bytes consumed by the reader so far.
+	uint64_t dropped() const noexcept; ///< Records refused because the ring was full.
+	size_t capacity() const noexcept { return data_capacity; } ///< Data bytes of the ring.
+
+	static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024; ///< Default data bytes.
+
+private:
+	struct Header;
+	struct RecordHeader;
+
+	ShmRing(void* mapping, size_t mapped_size);
+
+	size_t read_records(void (*visit)(const ShmEntry&, void*), void* context, size_t max_records);
+
+	RecordHeader* record_at(uint64_t position) const noexcept;
+
+	Header* header { nullptr }; ///< Control block at the start of the segment.
+	char* data { nullptr }; ///< The ring bytes, right after the header.
+	size_t data_capacity { 0 }; ///< Size of data, a power of two.
+	size_t mapped_size { 0 }; ///< Size of the whole mapping.
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "tail_ring.h"
+#include <algorithm>
+#include <cstring>
+
+TailRing::TailRing(size_t capacity)
+    : slot_count(std::max<size_t>(capacity, 1))
+    , slots(std::make_unique<Slot[]>(slot_count)) { }
+
+void TailRing::push(std::string_view line) noexcept {
+	if (!line.empty() && line.back() == '\n') {
+		line.remove_suffix(1);
+	}
+	const size_t size = std::min(line.size(), kLineCapacity);
+	const uint64_t position = head.load(std::memory_order_relaxed);
+	Slot& slot = slots[position % slot_count];
+
+	/* release on every word: a reader that sees one also sees the odd sequence before it */
+	slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+	for (size_t offset = 0; offset < size; offset += sizeof(uint64_t)) {
+		uint64_t word = 0;
+		std::memcpy(&word, line.data() + offset, std::min(sizeof(word), size - offset));
+		slot.text[offset / sizeof(uint64_t)].store(word, std::memory_order_release);
+	}
+	slot.length.store(static_cast<uint32_t>(size), std::memory_order_release);
+	slot.sequence.store(2 * (position + 1), std::memory_order_release);
+	head.store(position + 1, std::memory_order_release);
+}
+
+std::vector<std::string> TailRing::snapshot(size_t max) const {
+	const uint64_t end = head.load(std::memory_order_acquire);
+	const uint64_t begin = end - std::min<uint64_t>({ end, slot_count, max });
+	std::vector<std::string> lines;
+	lines.reserve(end - begin);
+	std::array<uint64_t, kWords> words;
+	for (uint64_t position = begin; position < end; ++position) {
+		const Slot& slot = slots[position % slot_count];
+		const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		/* odd: being written, larger: already overwritten by a newer line */
+		if (sequence != 2 * (position + 1)) {
+			continue;
+		}
+		/* acquire loads keep the second sequence load after the copy */
+		const size_t size = std::min<size_t>(slot.length.load(std::memory_order_acquire), kLineCapacity);
+		for (size_t i = 0; i * sizeof(uint64_t) < size; ++i) {
+			words[i] = slot.text[i].load(std::memory_order_acquire);
+		}
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+			continue;
+		}
+		lines.emplace_back(reinterpret_cast<const char*>(words.data()), size);
+	}
+	return lines;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file tail_ring.h
+ * @brief Defines TailRing, the most recent formatted lines of a logger, readable without locks.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A bounded ring of the last capacity() lines written, for live inspection.
+ *
+ * One writer, the CCLogger worker, copies each line it wrote into the next
+ * slot; any number of readers (an admin endpoint, a debug command) take a
+ * snapshot() at any time. Every slot is a seqlock: readers copy it and
+ * check its sequence did not move meanwhile, and simply skip a slot the
+ * writer is overwriting. Neither side ever waits for the other, so
+ * inspection costs the logging path nothing but the copy of the line.
+ * The text lives in atomic words, so the racing copies are well defined.
+ */
+class TailRing {
+public:
+	DISABLE_COPY_MOVE(TailRing);
+	TailRing() = delete;
+
+	static constexpr size_t kLineCapacity = 512; ///< Bytes kept of a line, longer lines are cut.
+
+	/**
+	 * @brief Allocates all slots up front.
+	 *
+	 * @param capacity Lines kept, at least 1.
+	 */
+	explicit TailRing(size_t capacity);
+
+	/**
+	 * @brief Stores a line, overwriting the oldest. Single writer only.
+	 *
+	 * @param line The formatted line, its trailing newline is dropped.
+	 */
+	void push(std::string_view line) noexcept;
+
+	/**
+	 * @brief Copies the most recent lines, oldest first, without blocking the writer.
+	 *
+	 * Lines overwritten while the snapshot is taken are left out, so it may
+	 * hold fewer than max lines even when more were written.
+	 * @param max Lines wanted at most.
+	 * @return The lines, without their trailing newline.
+	 */
+	std::vector<std::string> snapshot(size_t max = SIZE_MAX) const;
+
+	/**
+	 * @brief Lines kept at most.
+	 */
+	size_t capacity() const noexcept { return slot_count; }
+
+	/**
+	 * @brief Lines pushed since construction.
+	 */
+	uint64_t pushed() const noexcept { return head.load(std::memory_order_acquire); }
+
+private:
+	static constexpr size_t kWords = kLineCapacity / sizeof(uint64_t);
+
+	struct alignas(64) Slot {
+		std::atomic<uint64_t> sequence { 0 }; ///< 2 * (position + 1) once stored, odd while being written.
+		std::atomic<uint32_t> length { 0 }; ///< Bytes of text in use.
+		std::array<std::atomic<uint64_t>, kWords> text {}; ///< The line, packed in words.
+	};
+
+	const size_t slot_count; ///< Number of slots.
+	std::unique_ptr<Slot[]> slots; ///< The ring.
+	std::atomic<uint64_t> head { 0 }; ///< Lines pushed, the next position to write.
+};
@@ -0,0 +1,75 @@
+# Optimization knobs for CCLogger: LTO, -march and a two step PGO workflow.
+#
+# PGO, in one build directory (or the pgo-generate / pgo-use presets):
+#   cmake -DCCLOGGER_PGO=GENERATE . && cmake --build . && cmake --build . --target cclogger_pgo_train
+#   cmake -DCCLOGGER_PGO=USE .      && cmake --build .
+
+option(CCLOGGER_ENABLE_LTO "Link time optimization for Release and RelWithDebInfo builds" ON)
+option(CCLOGGER_FORCE_INLINE "Force inlining of the small hot path helpers (CCLOGGER_HOT_INLINE)" ON)
+set(CCLOGGER_INLINE_PAYLOAD 256 CACHE STRING "Message bytes stored inline in a queue slot before spilling to the overflow pool")
+set(CCLOGGER_MARCH "" CACHE STRING "Passed as -march=<value>, e.g. native. Empty keeps the compiler default")
+set(CCLOGGER_PGO "OFF" CACHE STRING "Profile guided optimization step: OFF, GENERATE or USE")
+set_property(CACHE CCLOGGER_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(CCLOGGER_PGO_DIR "${CMAKE_BINARY_DIR}/pgo-profiles" CACHE PATH "Where PGO profiles are written and read")
+
+if(CCLOGGER_ENABLE_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT CCLOGGER_IPO_SUPPORTED OUTPUT CCLOGGER_IPO_ERROR LANGUAGES CXX)
+    if(CCLOGGER_IPO_SUPPORTED)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_RELEASE ON)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON)
+    else()
+        message(WARNING "CCLogger: LTO requested but not supported: ${CCLOGGER_IPO_ERROR}")
+    endif()
+endif()
+
+if(CCLOGGER_MARCH)
+    add_compile_options(-march=${CCLOGGER_MARCH})
+endif()
+
+set(CCLOGGER_IS_CLANG OFF)
+if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    set(CCLOGGER_IS_CLANG ON)
+endif()
+
+if(CCLOGGER_PGO STREQUAL "GENERATE")
+    file(MAKE_DIRECTORY ${CCLOGGER_PGO_DIR})
+    if(CCLOGGER_IS_CLANG)
+        add_compile_options(-fprofile-generate=${CCLOGGER_PGO_DIR})
+        add_link_options(-fprofile-generate=${CCLOGGER_PGO_DIR})
+    else()
+        # the worker and the producers run the same code concurrently
+        add_compile_options(-fprofile-generate=${CCLOGGER_PGO_DIR} -fprofile-update=atomic)
+        add_link_options(-fprofile-generate=${CCLOGGER_PGO_DIR})
+    endif()
+elseif(CCLOGGER_PGO STREQUAL "USE")
+    if(CCLOGGER_IS_CLANG)
+        add_compile_options(-fprofile-use=${CCLOGGER_PGO_DIR}/cclogger.profdata)
+        add_link_options(-fprofile-use=${CCLOGGER_PGO_DIR}/cclogger.profdata)
+    else()
+        add_compile_options(-fprofile-use=${CCLOGGER_PGO_DIR} -fprofile-correction -Wno-missing-profile)
+        add_link_options(-fprofile-use=${CCLOGGER_PGO_DIR})
+    endif()
+elseif(NOT CCLOGGER_PGO STREQUAL "OFF")
+    message(FATAL_ERROR "CCLogger: CCLOGGER_PGO must be OFF, GENERATE or USE, got '${CCLOGGER_PGO}'")
+endif()
+
+# Runs the benchmark and the demo to collect profiles, call after building with CCLOGGER_PGO=GENERATE.
+function(cclogger_add_pgo_training)
+    if(NOT CCLOGGER_PGO STREQUAL "GENERATE")
+        return()
+    endif()
+    set(train_commands
+        COMMAND $<TARGET_FILE:cclogger_bench> --quick
+        COMMAND $<TARGET_FILE:fast_main>)
+    if(CCLOGGER_IS_CLANG)
+        find_program(CCLOGGER_LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+        list(APPEND train_commands
+            COMMAND ${CCLOGGER_LLVM_PROFDATA} merge -output=${CCLOGGER_PGO_DIR}/cclogger.profdata ${CCLOGGER_PGO_DIR})
+    endif()
+    add_custom_target(cclogger_pgo_train
+        ${train_commands}
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        DEPENDS cclogger_bench fast_main
+        COMMENT "Collecting CCLogger PGO profiles into ${CCLOGGER_PGO_DIR}")
+endfunction()
\ No newline at end of file
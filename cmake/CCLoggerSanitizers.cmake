@@ -0,0 +1,17 @@
+# Sanitizer builds for CCLogger, e.g. the tsan preset:
+#   cmake --preset tsan && cmake --build --preset tsan && ctest --preset tsan
+# test_stress is the one meant for them: it runs every worker wait strategy
+# and the format pool with many producers, ThreadSanitizer checks the races.
+
+set(CCLOGGER_SANITIZE "" CACHE STRING "Builds everything with -fsanitize=<value>: thread, address or undefined. Empty for none")
+set_property(CACHE CCLOGGER_SANITIZE PROPERTY STRINGS "" thread address undefined)
+
+if(CCLOGGER_SANITIZE)
+    if(NOT CCLOGGER_SANITIZE MATCHES "^(thread|address|undefined)$")
+        message(FATAL_ERROR "CCLogger: CCLOGGER_SANITIZE must be thread, address or undefined, got '${CCLOGGER_SANITIZE}'")
+    endif()
+    add_compile_options(-fsanitize=${CCLOGGER_SANITIZE} -fno-omit-frame-pointer -g)
+    add_link_options(-fsanitize=${CCLOGGER_SANITIZE})
+    # the tests skip what cannot work under a sanitizer, e.g. crashing on purpose
+    add_compile_definitions(CCLOGGER_SANITIZED)
+endif()
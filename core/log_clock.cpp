@@ -0,0 +1,191 @@
+#include "log_clock.h"
+#include <cmath>
+#include <mutex>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+using namespace std::chrono;
+
+int64_t system_ns() noexcept {
+	return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+int64_t coarse_ns() noexcept {
+	timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+}
+
+uint64_t read_tsc() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Tick to wall time mapping of the TSC, published with a seqlock.
+ */
+struct TscCalibration {
+	std::atomic<uint32_t> seq { 0 };
+	std::atomic<uint64_t> tick_base { 0 };
+	std::atomic<int64_t> ns_base { 0 };
+	std::atomic<double> ns_per_tick { 0.0 };
+
+	void publish(uint64_t tick, int64_t ns, double rate) noexcept {
+		const uint32_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		tick_base.store(tick, std::memory_order_relaxed);
+		ns_base.store(ns, std::memory_order_relaxed);
+		ns_per_tick.store(rate, std::memory_order_relaxed);
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+	int64_t to_ns(uint64_t tick) const noexcept {
+		while (true) {
+			const uint32_t before = seq.load(std::memory_order_acquire);
+			if (before & 1) {
+				continue;
+			}
+			const uint64_t base = tick_base.load(std::memory_order_relaxed);
+			const int64_t ns = ns_base.load(std::memory_order_relaxed);
+			const double rate = ns_per_tick.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) == before) {
+				const auto delta = static_cast<int64_t>(tick - base);
+				return ns + static_cast<int64_t>(std::llround(static_cast<double>(delta) * rate));
+			}
+		}
+	}
+};
+
+struct ClockState {
+	TscCalibration tsc;
+	std::atomic<int64_t> coarse_offset_ns { 0 }; ///< system_ns() - coarse_ns().
+	std::atomic<int64_t> next_due_ns { 0 }; ///< steady_clock time of the next calibration.
+	std::mutex calibrating; ///< Only one thread calibrates at a time.
+	uint64_t anchor_tick { 0 }; ///< Start of the long TSC baseline, guarded by calibrating.
+	int64_t anchor_ns { 0 };
+};
+
+ClockState& state() {
+	static ClockState* instance = new ClockState;
+	return *instance;
+}
+
+int64_t steady_ns() noexcept {
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Measures the TSC rate over the anchor baseline and publishes it. Needs state().calibrating.
+ *
+ * A wall clock step (settimeofday) skews the baseline: a rate off by more
+ * than 1% from the previous one, or a baseline that went backwards, is not
+ * trusted. The previous rate is published from the new wall time instead,
+ * and a fresh baseline starts.
+ */
+void calibrate_tsc_locked(ClockState& clock) {
+	const uint64_t tick = read_tsc();
+	const int64_t ns = system_ns();
+	const uint64_t ticks = tick - clock.anchor_tick;
+	const int64_t elapsed = ns - clock.anchor_ns;
+	if (ticks == 0) {
+		return;
+	}
+	const double rate = static_cast<double>(elapsed) / static_cast<double>(ticks);
+	const double previous = clock.tsc.ns_per_tick.load(std::memory_order_relaxed);
+	if (elapsed <= 0 || (previous > 0.0 && std::abs(rate - previous) > previous * 0.01)) {
+		if (previous > 0.0) {
+			clock.tsc.publish(tick, ns, previous);
+		}
+		clock.anchor_tick = tick;
+		clock.anchor_ns = ns;
+		return;
+	}
+	clock.tsc.publish(tick, ns, rate);
+}
+
+}
+
+bool LogClock::tsc_invariant() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned eax, ebx, ecx, edx;
+	if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+		return false;
+	}
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+	return (edx & (1u << 8)) != 0;
+#else
+	return false;
+#endif
+}
+
+ClockSource LogClock::set_source(ClockSource wanted) {
+	auto& clock = state();
+	if (wanted == ClockSource::Tsc) {
+		if (!tsc_invariant()) {
+			wanted = ClockSource::System;
+		} else {
+			std::lock_guard<std::mutex> lock(clock.calibrating);
+			clock.anchor_tick = read_tsc();
+			clock.anchor_ns = system_ns();
+			std::this_thread::sleep_for(milliseconds(10));
+			calibrate_tsc_locked(clock);
+			if (clock.tsc.ns_per_tick.load(std::memory_order_relaxed) <= 0.0) {
+				wanted = ClockSource::System;
+			}
+		}
+	}
+	if (wanted == ClockSource::MonotonicCoarse) {
+		clock.coarse_offset_ns.store(system_ns() - coarse_ns(), std::memory_order_relaxed);
+	}
+	clock.next_due_ns.store(steady_ns() + duration_cast<nanoseconds>(kCalibrationInterval).count(),
+	                        std::memory_order_relaxed);
+	current.store(wanted, std::memory_order_relaxed);
+	return wanted;
+}
+
+system_clock::time_point LogClock::to_system(Stamp stamp) noexcept {
+	auto& clock = state();
+	int64_t ns;
+	switch (stamp.source) {
+	case ClockSource::Tsc:
+		ns = clock.tsc.to_ns(stamp.ticks);
+		break;
+	case ClockSource::MonotonicCoarse:
+		ns = static_cast<int64_t>(stamp.ticks) + clock.coarse_offset_ns.load(std::memory_order_relaxed);
+		break;
+	default:
+		ns = static_cast<int64_t>(stamp.ticks);
+		break;
+	}
+	return system_clock::time_point(duration_cast<system_clock::duration>(nanoseconds(ns)));
+}
+
+void LogClock::calibrate() {
+	auto& clock = state();
+	std::lock_guard<std::mutex> lock(clock.calibrating);
+	clock.coarse_offset_ns.store(system_ns() - coarse_ns(), std::memory_order_relaxed);
+	if (clock.tsc.ns_per_tick.load(std::memory_order_relaxed) > 0.0) {
+		calibrate_tsc_locked(clock);
+	}
+	clock.next_due_ns.store(steady_ns() + duration_cast<nanoseconds>(kCalibrationInterval).count(),
+	                        std::memory_order_relaxed);
+}
+
+void LogClock::calibrate_if_due() {
+	if (source() == ClockSource::System) {
+		return;
+	}
+	if (steady_ns() < state().next_due_ns.load(std::memory_order_relaxed)) {
+		return;
+	}
+	calibrate();
+}
@@ -0,0 +1,112 @@
+/**
+ * @file log_clock.h
+ * @brief Defines LogClock, the cheap timestamp source used on the producer side.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @enum ClockSource
+ * @brief Where producer timestamps come from.
+ */
+enum class ClockSource : uint8_t {
+	System, ///< std::chrono::system_clock, ticks are nanoseconds since the epoch (default).
+	MonotonicCoarse, ///< CLOCK_MONOTONIC_COARSE, very cheap but only jiffy resolution.
+	Tsc ///< The CPU time stamp counter, cheapest and finest; needs an invariant TSC.
+};
+
+/**
+ * @brief Process wide producer clock.
+ *
+ * Producers only read raw ticks (now()); turning ticks into calendar time
+ * is deferred to formatting (to_system()). For the non-system sources the
+ * tick to wall time mapping is recalibrated by the worker threads through
+ * calibrate_if_due(), and published with a seqlock so readers never block.
+ */
+class LogClock {
+public:
+	/**
+	 * @brief A raw timestamp and the source it was read from.
+	 */
+	struct Stamp {
+		uint64_t ticks { 0 }; ///< Raw ticks, meaning depends on source.
+		ClockSource source { ClockSource::System }; ///< The source ticks came from.
+	};
+
+	/**
+	 * @brief Switches the process wide source.
+	 *
+	 * Selecting Tsc blocks ~10 ms for the first calibration. When the TSC
+	 * is not invariant (or not x86) it falls back to System.
+	 * @param wanted The source to use.
+	 * @return The source actually in use afterwards.
+	 */
+	static ClockSource set_source(ClockSource wanted);
+
+	/**
+	 * @brief The source now() currently reads.
+	 */
+	static ClockSource source() noexcept { return current.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Whether the CPU advertises an invariant TSC (constant rate, not stopped in sleep states).
+	 */
+	static bool tsc_invariant() noexcept;
+
+	/**
+	 * @brief Reads the current timestamp, the producer side hot path.
+	 */
+	static CCLOGGER_HOT_INLINE Stamp now() noexcept {
+		const ClockSource src = current.load(std::memory_order_relaxed);
+		switch (src) {
+#if defined(__x86_64__) || defined(__i386__)
+		case ClockSource::Tsc:
+			return { __rdtsc(), src };
+#endif
+		case ClockSource::MonotonicCoarse: {
+			timespec ts;
+			::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+			return { static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec), src };
+		}
+		default:
+			return { static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			                                   std::chrono::system_clock::now().time_since_epoch())
+			                                   .count()),
+				     ClockSource::System };
+		}
+	}
+
+	/**
+	 * @brief Converts a stamp into calendar time using the latest calibration.
+	 *
+	 * @param stamp A stamp returned by now().
+	 * @return The corresponding system_clock time point.
+	 */
+	static std::chrono::system_clock::time_point to_system(Stamp stamp) noexcept;
+
+	/**
+	 * @brief Recalibrates the non-system sources now.
+	 */
+	static void calibrate();
+
+	/**
+	 * @brief Recalibrates if the last calibration is older than the interval; cheap otherwise.
+	 *
+	 * Called by the worker threads once per batch.
+	 */
+	static void calibrate_if_due();
+
+	static constexpr std::chrono::milliseconds kCalibrationInterval { 1000 }; ///< Worker recalibration period.
+
+private:
+	static inline std::atomic<ClockSource> current { ClockSource::System };
+};
@@ -0,0 +1,21 @@
+#include "log_context.h"
+
+LogContext::LogContext(const LogContext* parent, std::string_view key, std::string_view value) {
+	const std::string_view inherited = parent ? std::string_view(parent->text) : std::string_view {};
+	text.reserve(inherited.size() + key.size() + value.size() + 2);
+	if (!inherited.empty()) {
+		text.append(inherited).push_back(' ');
+	}
+	text.append(key).append("=").append(value);
+}
+
+LogScope::LogScope(std::string_view key, std::string_view value)
+    : frame(new LogContext(LogContext::top, key, value))
+    , previous(LogContext::top) {
+	LogContext::top = frame;
+}
+
+LogScope::~LogScope() {
+	LogContext::top = previous;
+	frame->release();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file log_context.h
+ * @brief Defines LogScope, a thread-local stack of key=value fields (MDC) attached to every record pushed inside it.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <atomic>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief One immutable frame of a thread's context stack.
+ *
+ * A frame holds the rendered fields of its scope and of every enclosing
+ * scope ("req=42 tenant=acme"), built once when the LogScope opens. Records
+ * pushed inside the scope take a counted reference to the innermost frame
+ * instead of copying the fields, so tagging a message costs a thread_local
+ * read and an atomic increment. The frame is freed by whoever drops the
+ * last reference, normally the worker once the record is written.
+ */
+class LogContext {
+public:
+	DISABLE_COPY_MOVE(LogContext);
+	LogContext() = delete;
+
+	/**
+	 * @brief Counted reference to a frame, what a LogRecord carries.
+	 */
+	class Ref {
+	public:
+		Ref() noexcept = default;
+		explicit Ref(const LogContext* frame) noexcept
+		    : frame(frame) {
+			if (frame != nullptr) {
+				frame->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		Ref(const Ref& other) noexcept
+		    : Ref(other.frame) { }
+		Ref(Ref&& other) noexcept
+		    : frame(std::exchange(other.frame, nullptr)) { }
+		Ref& operator=(Ref other) noexcept {
+			std::swap(frame, other.frame);
+			return *this;
+		}
+		~Ref() {
+			if (frame != nullptr) {
+				frame->release();
+			}
+		}
+
+		/**
+		 * @brief The rendered fields, empty without a frame.
+		 */
+		std::string_view text() const noexcept { return frame ? std::string_view(frame->text) : std::string_view {}; }
+
+		const LogContext* get() const noexcept { return frame; } ///< The frame, null outside any scope.
+		explicit operator bool() const noexcept { return frame != nullptr; } ///< Whether there is a frame.
+
+	private:
+		const LogContext* frame { nullptr }; ///< Referenced frame.
+	};
+
+	/**
+	 * @brief A reference to the calling thread's innermost frame, empty outside any LogScope.
+	 */
+	static CCLOGGER_HOT_INLINE Ref current() noexcept { return Ref(top); }
+
+	/**
+	 * @brief The calling thread's rendered fields, valid until its innermost LogScope closes.
+	 */
+	static std::string_view current_text() noexcept { return top ? std::string_view(top->text) : std::string_view {}; }
+
+	/**
+	 * @brief The rendered fields of this frame and its enclosing ones.
+	 */
+	std::string_view get_text() const noexcept { return text; }
+
+private:
+	friend class LogScope;
+
+	/**
+	 * @brief Builds a frame on top of parent with one more field.
+	 */
+	LogContext(const LogContext* parent, std::string_view key, std::string_view value);
+
+	~LogContext() = default;
+
+	/**
+	 * @brief Drops one reference, freeing the frame with the last one.
+	 */
+	void release() const noexcept {
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete this;
+		}
+	}
+
+	std::string text; ///< "key=value" pairs separated by spaces, outermost first.
+	mutable std::atomic<uint32_t> refs { 1 }; ///< The scope's reference plus one per record.
+
+	static inline thread_local const LogContext* top = nullptr; ///< Innermost frame of this thread.
+};
+
+/**
+ * @brief RAII scope adding a field to every record the thread pushes until it closes.
+ *
+ * `LogScope ctx { "req", request_id };` renders "req=<id>" once; scopes nest
+ * and must close in reverse order, which automatic variables guarantee.
+ */
+class LogScope {
+public:
+	DISABLE_COPY_MOVE(LogScope);
+	LogScope() = delete;
+
+	/**
+	 * @brief Opens a scope with a string field.
+	 *
+	 * @param key The field name.
+	 * @param value The field value, copied.
+	 */
+	LogScope(std::string_view key, std::string_view value);
+
+	/**
+	 * @brief Opens a scope with an integer field.
+	 *
+	 * @param key The field name.
+	 * @param value The field value, rendered in decimal.
+	 */
+	template <std::integral Integer>
+	    requires(!std::same_as<Integer, bool>)
+	LogScope(std::string_view key, Integer value)
+	    : LogScope(key, render(value).view()) { }
+
+	/**
+	 * @brief Closes the scope, the enclosing one is current again.
+	 */
+	~LogScope();
+
+private:
+	/**
+	 * @brief An integer rendered on the stack.
+	 */
+	struct Digits {
+		char data[24];
+		size_t size;
+		std::string_view view() const noexcept { return { data, size }; }
+	};
+
+	template <std::integral Integer>
+	static Digits render(Integer value) noexcept {
+		Digits digits;
+		digits.size = static_cast<size_t>(std::to_chars(digits.data, digits.data + sizeof(digits.data), value).ptr - digits.data);
+		return digits;
+	}
+
+	const LogContext* frame; ///< The frame this scope pushed.
+	const LogContext* previous; ///< The frame current before it.
+};
@@ -1,17 +1,36 @@
 #include "logger_tools.h"
+#include "thread_registry.h"
 #include <chrono>
 #include <format>
-#include <thread>
 
-std::string LoggerTools::current_time() {
+std::string AbsLoggerTools::format_time(std::chrono::system_clock::time_point tp) {
 	using namespace std::chrono;
-	const auto now = system_clock::now();
-	const auto secs = floor<seconds>(now);
-	const auto ns = duration_cast<nanoseconds>(now - secs);
-	return std::format("{:%Y-%m-%d %H:%M:%S}.{:09}", secs, ns.count());
+	const auto secs = floor<seconds>(tp);
+	auto ns = duration_cast<nanoseconds>(tp - secs).count();
+
+	/* the worker formats many records per second, render the date part once */
+	thread_local sys_seconds cached_secs {};
+	thread_local std::string cached_prefix;
+	if (cached_prefix.empty() || secs != cached_secs) {
+		cached_prefix = std::format("{:%Y-%m-%d %H:%M:%S}.", secs);
+		cached_secs = secs;
+	}
+
+	char digits[9];
+	for (int i = 8; i >= 0; --i) {
+		digits[i] = static_cast<char>('0' + ns % 10);
+		ns /= 10;
+	}
+	std::string result;
+	result.reserve(cached_prefix.size() + sizeof(digits));
+	result.append(cached_prefix).append(digits, sizeof(digits));
+	return result;
+}
+
+std::string LoggerTools::current_time() {
+	return format_time(std::chrono::system_clock::now());
 }
 
 std::string LoggerTools::thread_id() {
-	return std::format("0x{:x}",
-	                   std::hash<std::thread::id> {}(std::this_thread::get_id()));
+	return ThreadRegistry::find(ThreadRegistry::current_index())->hash_id;
 }
\ No newline at end of file
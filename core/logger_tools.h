@@ -1,9 +1,13 @@
 #pragma once
 
-#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 /**
  * @enum LogLevel
@@ -32,28 +36,122 @@ constexpr std::underlying_type_t<LogLevel> Weight(LogLevel level) {
 	return static_cast<uint8_t>(level);
 }
 
+/**
+ * @brief Number of LogLevel values, OFF included.
+ */
+inline constexpr size_t kLogLevelCount = Weight(LogLevel::OFF) + 1;
+
+/**
+ * @brief Level names indexed by Weight(level).
+ */
+inline constexpr std::array<std::string_view, kLogLevelCount> kLevelNames = {
+	"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF"
+};
+
+/**
+ * @brief Width of the longest level name, what the padded names are padded to.
+ */
+inline constexpr size_t kLevelNameWidth = [] {
+	size_t width = 0;
+	for (auto name : kLevelNames)
+		width = name.size() > width ? name.size() : width;
+	return width;
+}();
+
+/**
+ * @brief Level names right-padded with spaces to kLevelNameWidth, indexed by Weight(level).
+ */
+inline constexpr std::array<std::string_view, kLogLevelCount> kPaddedLevelNames = {
+	"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR", "FATAL", "OFF  "
+};
+
+static_assert([] {
+	for (size_t i = 0; i < kLogLevelCount; ++i) {
+		if (kPaddedLevelNames[i].size() != kLevelNameWidth || kPaddedLevelNames[i].substr(0, kLevelNames[i].size()) != kLevelNames[i])
+			return false;
+	}
+	return true;
+}(),
+              "kPaddedLevelNames must match kLevelNames");
+
+/**
+ * @brief ANSI SGR sequences coloring each level on a terminal, indexed by Weight(level).
+ */
+inline constexpr std::array<std::string_view, kLogLevelCount> kLevelColors = {
+	"\x1b[90m", "\x1b[36m", "\x1b[32m", "\x1b[33m", "\x1b[31m", "\x1b[1;31m", ""
+};
+
+/**
+ * @brief ANSI sequence ending a colored span.
+ */
+inline constexpr std::string_view kColorReset = "\x1b[0m";
+
 /**
  * @brief Abstract interface for logger utilities.
  *
- * This interface defines the conversion between log levels and strings,
- * as well as utility functions for timestamp and thread ID.
+ * The level names are fixed tables and need no customization, so the
+ * conversions are constexpr and non-virtual; only the timestamp and
+ * thread ID utilities are meant to be overridden.
  */
 struct AbsLoggerTools {
+	virtual ~AbsLoggerTools() = default;
+
 	/**
 	 * @brief Converts a LogLevel to its string representation.
 	 *
 	 * @param level The log level to convert.
-	 * @return The corresponding string representation.
+	 * @return The corresponding string representation, a view into a static table.
 	 */
-	virtual constexpr const std::string& toString(LogLevel level) = 0;
+	static constexpr std::string_view toString(LogLevel level) noexcept {
+		const auto index = Weight(level);
+		return index < kLogLevelCount ? kLevelNames[index] : std::string_view {};
+	}
 
 	/**
-	 * @brief Parses a string to determine the corresponding LogLevel.
+	 * @brief Converts a LogLevel to its name padded to kLevelNameWidth, for aligned columns.
+	 *
+	 * @param level The log level to convert.
+	 * @return The padded name, a view into a static table.
+	 */
+	static constexpr std::string_view toPaddedString(LogLevel level) noexcept {
+		const auto index = Weight(level);
+		return index < kLogLevelCount ? kPaddedLevelNames[index] : std::string_view {};
+	}
+
+	/**
+	 * @brief Parses a level name, case-insensitively and without allocating.
 	 *
 	 * @param str The string representation of the log level.
+	 * @return The parsed LogLevel, or std::nullopt if str names no level.
+	 */
+	static constexpr std::optional<LogLevel> tryFromString(std::string_view str) noexcept {
+		for (size_t i = 0; i < kLogLevelCount; ++i) {
+			const std::string_view name = kLevelNames[i];
+			if (name.size() != str.size())
+				continue;
+			bool same = true;
+			for (size_t c = 0; c < name.size() && same; ++c) {
+				const char lower = (str[c] >= 'a' && str[c] <= 'z') ? static_cast<char>(str[c] - 'a' + 'A') : str[c];
+				same = lower == name[c];
+			}
+			if (same)
+				return static_cast<LogLevel>(i);
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief Parses a string to determine the corresponding LogLevel.
+	 *
+	 * @param str The string representation of the log level, case-insensitive.
 	 * @return The parsed LogLevel.
+	 * @throws std::out_of_range if str names no level.
 	 */
-	virtual constexpr LogLevel fromString(const std::string& str) = 0;
+	static constexpr LogLevel fromString(std::string_view str) {
+		if (const auto level = tryFromString(str))
+			return *level;
+		throw std::out_of_range("unknown log level");
+	}
 
 	/**
 	 * @brief Gets the current system time as a string.
@@ -62,6 +160,17 @@ struct AbsLoggerTools {
 	 */
 	virtual std::string current_time() = 0;
 
+	/**
+	 * @brief Formats a time point captured earlier, e.g. a record's timestamp.
+	 *
+	 * The default prints "YYYY-mm-dd HH:MM:SS.nnnnnnnnn" (UTC) and only
+	 * re-renders the date part when the second changes.
+	 *
+	 * @param tp The time to format.
+	 * @return The time in string format.
+	 */
+	virtual std::string format_time(std::chrono::system_clock::time_point tp);
+
 	/**
 	 * @brief Gets the current thread ID as a string.
 	 *
@@ -70,43 +179,17 @@ struct AbsLoggerTools {
 	virtual std::string thread_id() = 0;
 };
 
+static_assert(AbsLoggerTools::toString(LogLevel::WARN) == "WARN");
+static_assert(AbsLoggerTools::fromString("Error") == LogLevel::ERROR);
+static_assert(!AbsLoggerTools::tryFromString("verbose"));
+
 /**
  * @brief Default implementation of AbsLoggerTools.
  *
- * Provides standard conversions and utilities for loggers.
+ * Provides standard conversions and utilities for loggers. It is final,
+ * so calls through a LoggerTools pointer are direct calls.
  */
-struct LoggerTools : public AbsLoggerTools {
-	/**
-	 * @copydoc AbsLoggerTools::toString
-	 */
-	constexpr const std::string& toString(LogLevel level) override {
-		static const std::unordered_map<LogLevel, std::string> kLevelNames = {
-			{ LogLevel::TRACE, "TRACE" },
-			{ LogLevel::DEBUG, "DEBUG" },
-			{ LogLevel::INFO, "INFO" },
-			{ LogLevel::WARN, "WARN" },
-			{ LogLevel::ERROR, "ERROR" },
-			{ LogLevel::FATAL, "FATAL" },
-			{ LogLevel::OFF, "OFF" }
-		};
-		return kLevelNames.at(level);
-	}
-
-	/**
-	 * @copydoc AbsLoggerTools::fromString
-	 */
-	constexpr LogLevel fromString(const std::string& str) override {
-		static const std::unordered_map<std::string, LogLevel> kLevelMap = {
-			{ "trace", LogLevel::TRACE }, { "debug", LogLevel::DEBUG }, { "info", LogLevel::INFO }, { "warn", LogLevel::WARN }, { "error", LogLevel::ERROR }, { "fatal", LogLevel::FATAL }, { "off", LogLevel::OFF }
-		};
-
-		std::string lower;
-		std::transform(str.begin(), str.end(), std::back_inserter(lower),
-		               [](char c) { return std::tolower(c); });
-
-		return kLevelMap.at(lower);
-	}
-
+struct LoggerTools final : public AbsLoggerTools {
 	/**
 	 * @brief Gets the current system time as a string.
 	 *
@@ -0,0 +1,91 @@
+#include "thread_placement.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <pthread.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kMpolPreferred = 1; ///< MPOL_PREFERRED of <numaif.h>, without linking libnuma.
+
+}
+
+bool ThreadPlacement::is_default() const noexcept {
+	return cpus.empty() && sched_policy == SCHED_OTHER && sched_priority == 0 && !nice && !numa_local_memory;
+}
+
+int ThreadPlacement::apply_to_current() const noexcept {
+	if (!cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (const int cpu : cpus) {
+			if (cpu < 0 || cpu >= CPU_SETSIZE) {
+				return EINVAL;
+			}
+			CPU_SET(cpu, &set);
+		}
+		if (const int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+			return error;
+		}
+	}
+	if (sched_policy != SCHED_OTHER || sched_priority != 0) {
+		sched_param param {};
+		param.sched_priority = sched_priority;
+		if (const int error = ::pthread_setschedparam(::pthread_self(), sched_policy, &param)) {
+			return error;
+		}
+	}
+	if (nice) {
+		/* on Linux the nice value is per thread, addressed by its TID */
+		const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+		if (::setpriority(PRIO_PROCESS, tid, *nice) != 0) {
+			return errno;
+		}
+	}
+	return 0;
+}
+
+int ThreadPlacement::numa_node() const noexcept {
+	const int cpu = cpus.empty() ? ::sched_getcpu() : cpus.front();
+	const int node = cpu < 0 ? -1 : numa_node_of_cpu(cpu);
+	return node < 0 ? 0 : node;
+}
+
+int ThreadPlacement::numa_node_of_cpu(int cpu) noexcept {
+	/* the cpu directory holds a "node<N>" link to its node */
+	const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+	DIR* dir = ::opendir(path.c_str());
+	if (dir == nullptr) {
+		return -1;
+	}
+	int node = -1;
+	while (const dirent* entry = ::readdir(dir)) {
+		if (std::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+			node = std::atoi(entry->d_name + 4);
+			break;
+		}
+	}
+	::closedir(dir);
+	return node;
+}
+
+bool ThreadPlacement::prefer_numa_node(const void* data, size_t size, int node) noexcept {
+#ifdef SYS_mbind
+	const auto page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+	const auto begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+	const auto end = (reinterpret_cast<uintptr_t>(data) + size) & ~(page - 1);
+	if (node < 0 || node >= 64 || end <= begin) {
+		return false;
+	}
+	const unsigned long mask = 1ul << node;
+	return ::syscall(SYS_mbind, begin, end - begin, kMpolPreferred, &mask, sizeof(mask) * 8, 0) == 0;
+#else
+	return false;
+#endif
+}
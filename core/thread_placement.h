@@ -0,0 +1,69 @@
+/**
+ * @file thread_placement.h
+ * @brief Defines ThreadPlacement, the CPU affinity, scheduling and NUMA settings of a background thread.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <sched.h>
+#include <vector>
+
+/**
+ * @brief Where and how a background thread (the CCLogger worker, an IO helper) runs.
+ *
+ * The defaults change nothing: the thread inherits the creator's affinity,
+ * policy and nice value. Meant to keep the logging thread off the CPUs of
+ * pinned latency-critical threads, and its memory on its own NUMA node.
+ */
+struct ThreadPlacement {
+	std::vector<int> cpus; ///< CPUs the thread may run on, empty keeps the inherited affinity.
+	int sched_policy { SCHED_OTHER }; ///< SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO or SCHED_RR.
+	int sched_priority { 0 }; ///< Static priority, 1..99 for SCHED_FIFO and SCHED_RR, else 0.
+	std::optional<int> nice; ///< Nice value of the thread, unset keeps the inherited one.
+	bool numa_local_memory { false }; ///< Allocate the queue slots on the thread's NUMA node.
+	size_t reserved_slots { 4096 }; ///< numa_local_memory: queue slots reserved, and placed, up front.
+
+	/**
+	 * @brief Whether applying this would change nothing.
+	 */
+	bool is_default() const noexcept;
+
+	/**
+	 * @brief Applies affinity, scheduling policy and nice value to the calling thread.
+	 *
+	 * @return 0, or the errno of the first setting that failed, e.g. EINVAL
+	 *         for a CPU that does not exist or EPERM for a realtime policy.
+	 */
+	int apply_to_current() const noexcept;
+
+	/**
+	 * @brief The NUMA node the thread's memory should live on.
+	 *
+	 * @return The node of the first CPU in cpus, or of the CPU the caller
+	 *         runs on when cpus is empty; 0 where the kernel does not tell.
+	 */
+	int numa_node() const noexcept;
+
+	/**
+	 * @brief The NUMA node of a CPU, from sysfs.
+	 *
+	 * @param cpu A CPU number.
+	 * @return The node, or -1 if unknown.
+	 */
+	static int numa_node_of_cpu(int cpu) noexcept;
+
+	/**
+	 * @brief Asks the kernel to back the not yet touched pages of a range from one node (MPOL_PREFERRED).
+	 *
+	 * Only whole pages inside the range are bound, so neighbouring data is
+	 * not affected. A no-op where mbind is unavailable.
+	 *
+	 * @param data Start of the range.
+	 * @param size Length in bytes.
+	 * @param node The preferred node.
+	 * @return Whether the policy was set.
+	 */
+	static bool prefer_numa_node(const void* data, size_t size, int node) noexcept;
+};
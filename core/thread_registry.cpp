@@ -0,0 +1,144 @@
+#include "thread_registry.h"
+#include <array>
+#include <deque>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * @brief One slot: the entries of its current and previous generation, at generation % 2.
+ */
+struct Slot {
+	std::array<std::atomic<ThreadRegistry::ThreadInfo*>, 2> entries {};
+	uint32_t generation { 0 }; ///< Generation of the thread owning the slot, guarded by the registry lock.
+};
+
+struct Segment {
+	std::array<Slot, ThreadRegistry::kSegmentSize> slots;
+};
+
+struct RegistryState {
+	std::array<std::atomic<Segment*>, ThreadRegistry::kMaxSegments> segments {};
+	std::atomic<uint32_t> published { 0 }; ///< Slots below this are allocated and have had an owner.
+	std::mutex locker; ///< Serializes registration, release and renaming.
+	std::deque<uint32_t> free_slots; ///< Slots of exited threads, reused oldest first.
+	std::deque<std::unique_ptr<ThreadRegistry::ThreadInfo>> retired; ///< Superseded entries, freed after kRetiredKeep.
+};
+
+/* leaked on purpose: threads may still log while static destructors run */
+RegistryState& state() {
+	static RegistryState* instance = new RegistryState;
+	return *instance;
+}
+
+Slot& slot_of(RegistryState& registry, uint32_t slot) {
+	return registry.segments[slot / ThreadRegistry::kSegmentSize].load(std::memory_order_acquire)
+	    ->slots[slot % ThreadRegistry::kSegmentSize];
+}
+
+}
+
+uint32_t ThreadRegistry::register_current() {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+
+	uint32_t slot;
+	if (!registry.free_slots.empty()) {
+		slot = registry.free_slots.front();
+		registry.free_slots.pop_front();
+	} else {
+		slot = registry.published.load(std::memory_order_relaxed);
+		/* the last slot is reserved for kExhausted and kUnregistered */
+		if (slot >= kSlotMask) {
+			return kExhausted;
+		}
+		auto& segment = registry.segments[slot / kSegmentSize];
+		if (segment.load(std::memory_order_relaxed) == nullptr) {
+			segment.store(new Segment, std::memory_order_release);
+		}
+	}
+
+	Slot& owner = slot_of(registry, slot);
+	const uint32_t generation = slot < registry.published.load(std::memory_order_relaxed) ? owner.generation + 1 : 0;
+	auto info = std::make_unique<ThreadInfo>();
+	info->generation = generation;
+	info->hash_id = std::format("0x{:x}", std::hash<std::thread::id> {}(std::this_thread::get_id()));
+#ifdef __linux__
+	info->os_tid = std::to_string(static_cast<long>(::syscall(SYS_gettid)));
+#endif
+	/* the entry two generations back moves out; readers may still hold it, so it is freed only much later */
+	if (ThreadInfo* old = owner.entries[generation % 2].exchange(info.release(), std::memory_order_acq_rel)) {
+		registry.retired.emplace_back(old);
+		if (registry.retired.size() > kRetiredKeep) {
+			registry.retired.pop_front();
+		}
+	}
+	owner.generation = generation;
+	if (slot == registry.published.load(std::memory_order_relaxed)) {
+		registry.published.store(slot + 1, std::memory_order_release);
+	}
+
+	/* gives the slot back when the thread exits */
+	struct ReleaseGuard {
+		~ReleaseGuard() { release_current(); }
+	};
+	static thread_local ReleaseGuard guard;
+	return ((generation << kSlotBits) & ~kSlotMask) | slot;
+}
+
+void ThreadRegistry::release_current() noexcept {
+	const uint32_t index = tls_index;
+	/* logging from a later thread_local destructor prints "?" rather than another thread's ID */
+	tls_index = kExhausted;
+	if ((index & kSlotMask) == kSlotMask) {
+		return;
+	}
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	registry.free_slots.push_back(index & kSlotMask);
+}
+
+const ThreadRegistry::ThreadInfo* ThreadRegistry::find(uint32_t index) noexcept {
+	auto& registry = state();
+	const uint32_t slot = index & kSlotMask;
+	if (slot >= registry.published.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	const uint32_t generation = index >> kSlotBits;
+	const ThreadInfo* info = slot_of(registry, slot).entries[generation % 2].load(std::memory_order_acquire);
+	if (info == nullptr || (info->generation & (UINT32_MAX >> kSlotBits)) != generation) {
+		return nullptr;
+	}
+	return info;
+}
+
+std::string_view ThreadRegistry::label(uint32_t index, bool os_tid) noexcept {
+	const ThreadInfo* info = find(index);
+	if (info == nullptr) {
+		return "?";
+	}
+	if (const std::string* name = info->name.load(std::memory_order_acquire)) {
+		return *name;
+	}
+	return (os_tid && !info->os_tid.empty()) ? std::string_view(info->os_tid) : std::string_view(info->hash_id);
+}
+
+void ThreadRegistry::set_current_name(std::string name) {
+	const uint32_t index = current_index();
+	if ((index & kSlotMask) == kSlotMask) {
+		return;
+	}
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	ThreadInfo* info = slot_of(registry, index & kSlotMask).entries[(index >> kSlotBits) % 2].load(std::memory_order_relaxed);
+	info->names.push_back(std::make_unique<const std::string>(std::move(name)));
+	info->name.store(info->names.back().get(), std::memory_order_release);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file thread_registry.h
+ * @brief Process wide registry that gives every logging thread a small index and cached ID strings.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Table of the threads that have logged something.
+ *
+ * A thread registers on its first log call and gets a 32 bit index, cached
+ * in a thread_local. Its ID strings are built once at registration, so log
+ * records only carry the index and the formatter resolves it to the cached
+ * string on the worker thread. Lookups are lock free.
+ *
+ * The low kSlotBits of an index pick a slot, the rest is the slot's
+ * generation. A thread hands its slot back when it exits, and the next
+ * thread to register reuses it with the generation bumped, so threads
+ * created per task do not grow the table. A slot keeps the entry of its
+ * previous generation too, so records a thread left queued before exiting
+ * still resolve to it after the slot is reused.
+ */
+class ThreadRegistry {
+public:
+	/**
+	 * @brief What the registry keeps per thread. Immutable once published, except for the name.
+	 */
+	struct ThreadInfo {
+		uint32_t generation { 0 }; ///< Generation of the slot this entry was built for.
+		std::string hash_id; ///< "0x..." of std::hash<std::thread::id>, the classic thread_id() string.
+		std::string os_tid; ///< Kernel thread ID (gettid) in decimal, empty where unsupported.
+		std::atomic<const std::string*> name { nullptr }; ///< User assigned name, null until set.
+		std::vector<std::unique_ptr<const std::string>> names; ///< Every name assigned, guarded by the registry lock.
+	};
+
+	static constexpr uint32_t kSegmentSize = 256; ///< Slots allocated at a time.
+	static constexpr uint32_t kMaxSegments = 4096; ///< Cap of kSegmentSize * kMaxSegments - 1 live threads.
+	static constexpr uint32_t kSlotBits = 20; ///< Index bits that pick the slot, the rest is the generation.
+	static constexpr uint32_t kSlotMask = (1u << kSlotBits) - 1;
+	static constexpr uint32_t kRetiredKeep = 1024; ///< Superseded entries kept alive before being freed.
+	static_assert(kSegmentSize * kMaxSegments == 1u << kSlotBits);
+
+	/**
+	 * @brief Index given to threads registering while every slot is taken; its label is "?".
+	 */
+	static constexpr uint32_t kExhausted = kSlotMask;
+
+	/**
+	 * @brief Index of the calling thread, registering it on first use.
+	 *
+	 * After the first call this is a single thread_local read.
+	 */
+	static CCLOGGER_HOT_INLINE uint32_t current_index() {
+		if (tls_index == kUnregistered) [[unlikely]] {
+			tls_index = register_current();
+		}
+		return tls_index;
+	}
+
+	/**
+	 * @brief Looks up a registered thread.
+	 *
+	 * @param index An index returned by current_index().
+	 * @return The thread's info, or nullptr for an unknown index, kExhausted, or a
+	 *         slot reused twice since the record was taken.
+	 */
+	static const ThreadInfo* find(uint32_t index) noexcept;
+
+	/**
+	 * @brief The string a formatter should print for a thread.
+	 *
+	 * @param index An index returned by current_index().
+	 * @param os_tid Prefer the kernel TID over the hashed std::thread::id.
+	 * @return The user assigned name if there is one, else the chosen ID string,
+	 *         "?" when find() knows no entry. The view stays valid until the
+	 *         slot has been reused kRetiredKeep more times, far longer than
+	 *         formatting one record takes.
+	 */
+	static std::string_view label(uint32_t index, bool os_tid = false) noexcept;
+
+	/**
+	 * @brief Assigns a name to the calling thread, shown instead of its ID.
+	 *
+	 * Meant to be called rarely (at thread start); superseded names are kept
+	 * alive so the worker can still be reading them.
+	 * @param name The new name.
+	 */
+	static void set_current_name(std::string name);
+
+private:
+	static constexpr uint32_t kUnregistered = UINT32_MAX; ///< Like kExhausted, in the last slot, which is never handed out.
+
+	/**
+	 * @brief Slow path of current_index(): builds the entry of the calling thread.
+	 */
+	static uint32_t register_current();
+
+	/**
+	 * @brief Hands the calling thread's slot back, run by a thread_local guard at thread exit.
+	 */
+	static void release_current() noexcept;
+
+	static inline thread_local uint32_t tls_index = kUnregistered; ///< Cached index of this thread.
+};
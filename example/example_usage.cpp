@@ -15,7 +15,6 @@ void simple_usage_example() {
 	fmtFactory->set_enable_srcLocation(true);
 	std::cout << "========== Simple Usage Example ==========\n";
 
-	auto tools = new LoggerTools();
 	auto io = new FileIO("simple_usage_log.txt");
 	CCLogger logger(io);
 	logger.set_formattor(fmtFactory);
@@ -39,7 +38,6 @@ void performance_test_example() {
 	fmtFactory->set_enable_srcLocation(true);
 	std::cout << "\n========== Performance Test Example ==========\n";
 
-	auto tools = new LoggerTools();
 	auto io = new FileIO("performance_test_log.txt");
 	CCLogger logger(io);
 	logger.set_formattor(fmtFactory);
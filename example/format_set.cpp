@@ -21,7 +21,6 @@ int main() {
 	fmtFactory->set_enable_threadid(true);
 	fmtFactory->set_enable_srcLocation(true);
 
-	auto tools = new LoggerTools();
 	auto io = new ConsoleIO;
 
 	CCLogger logger(io);
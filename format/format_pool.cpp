@@ -0,0 +1,92 @@
+#include "format_pool.h"
+#include "logger_format.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+FormatPool::FormatPool(size_t helpers, const ThreadPlacement& placement)
+    : chunk_ns(std::max<size_t>(helpers, 1) + 1, 0) {
+	threads.reserve(chunk_ns.size() - 1);
+	for (size_t i = 1; i < chunk_ns.size(); ++i) {
+		threads.emplace_back([this, i, placement]() { run(i, placement); });
+	}
+}
+
+FormatPool::~FormatPool() {
+	{
+		std::lock_guard<std::mutex> guard(locker);
+		stopping = true;
+	}
+	start_cv.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void FormatPool::format(LoggerFormatFactory& formatter, const LogRecord* records, size_t count, std::string* lines) {
+	const size_t chunks = std::clamp<size_t>(count / kMinChunk, 1, chunk_ns.size());
+	std::fill(chunk_ns.begin(), chunk_ns.end(), 0);
+	{
+		std::lock_guard<std::mutex> guard(locker);
+		job_formatter = &formatter;
+		job_records = records;
+		job_lines = lines;
+		job_count = count;
+		job_chunks = chunks;
+		pending = chunks - 1;
+		++generation;
+	}
+	if (chunks > 1) {
+		start_cv.notify_all();
+	}
+	format_chunk(0);
+
+	std::unique_lock<std::mutex> lock(locker);
+	done_cv.wait(lock, [this]() { return pending == 0; });
+}
+
+uint64_t FormatPool::busy_ns() const noexcept {
+	return std::accumulate(chunk_ns.begin(), chunk_ns.end(), uint64_t { 0 });
+}
+
+void FormatPool::run(size_t index, const ThreadPlacement& placement) {
+	/* the worker already applied the same placement, so a failure here is not new: format where we are */
+	if (!placement.is_default()) {
+		placement.apply_to_current();
+	}
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(locker);
+			start_cv.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+			/* small batches use fewer chunks, the rest of the helpers sit this one out */
+			if (index >= job_chunks) {
+				continue;
+			}
+		}
+		format_chunk(index);
+		bool last = false;
+		{
+			std::lock_guard<std::mutex> guard(locker);
+			last = --pending == 0;
+		}
+		if (last) {
+			done_cv.notify_one();
+		}
+	}
+}
+
+void FormatPool::format_chunk(size_t chunk) {
+	/* the job fields are stable until every chunk is done */
+	const size_t begin = job_count * chunk / job_chunks;
+	const size_t end = job_count * (chunk + 1) / job_chunks;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = begin; i < end; ++i) {
+		job_lines[i] = job_formatter->format(job_records[i]);
+	}
+	chunk_ns[chunk] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file format_pool.h
+ * @brief Defines FormatPool, helper threads that format one batch of records in parallel chunks.
+ */
+
+#pragma once
+
+#include "cached_queue/log_record.h"
+#include "core/thread_placement.h"
+#include "tools/class_helper.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LoggerFormatFactory;
+
+/**
+ * @brief Splits a batch into contiguous chunks and formats them on helper threads.
+ *
+ * The calling thread formats the first chunk itself and returns once all
+ * chunks are done, so the caller (the CCLogger worker) stays the only one
+ * writing, in the original order. Each helper owns one chunk per batch and
+ * writes only its own lines, so no line is shared between threads.
+ *
+ * The formatter must be safe to call from several threads at once, which
+ * DummyFormatFactory and DefLoggerFormatFactory are, as long as custom
+ * AbsLoggerTools given to the latter are too.
+ */
+class FormatPool {
+public:
+	DISABLE_COPY_MOVE(FormatPool);
+	FormatPool() = delete;
+
+	static constexpr size_t kMinChunk = 64; ///< Fewest records worth handing to another thread.
+
+	/**
+	 * @brief Starts the helper threads.
+	 *
+	 * @param helpers Threads besides the caller, at least 1.
+	 * @param placement Applied by each helper before its first job, normally
+	 *        the CCLogger worker's, so the helpers stay on the same CPUs.
+	 */
+	explicit FormatPool(size_t helpers, const ThreadPlacement& placement = {});
+
+	/**
+	 * @brief Stops and joins the helper threads.
+	 */
+	~FormatPool();
+
+	/**
+	 * @brief Formats count records into lines[0, count), in parallel.
+	 *
+	 * @param formatter The formatter, called concurrently.
+	 * @param records The records.
+	 * @param count Number of records.
+	 * @param lines Receives one formatted line per record, at the same index.
+	 */
+	void format(LoggerFormatFactory& formatter, const LogRecord* records, size_t count, std::string* lines);
+
+	/**
+	 * @brief Formatting time of the last format(), summed over all threads.
+	 */
+	uint64_t busy_ns() const noexcept;
+
+	/**
+	 * @brief Threads besides the caller.
+	 */
+	size_t helpers() const noexcept { return threads.size(); }
+
+private:
+	/**
+	 * @brief Loop of helper index, chunk index + 1 of every batch, after applying the placement.
+	 */
+	void run(size_t index, const ThreadPlacement& placement);
+
+	/**
+	 * @brief Formats one chunk of the current job and times it.
+	 */
+	void format_chunk(size_t chunk);
+
+	std::vector<std::thread> threads; ///< The helpers.
+	std::vector<uint64_t> chunk_ns; ///< Formatting time of each chunk of the last job.
+	std::mutex locker; ///< Guards the job fields below.
+	std::condition_variable start_cv; ///< Wakes helpers for a new job.
+	std::condition_variable done_cv; ///< Wakes the caller when the last helper finished.
+	uint64_t generation { 0 }; ///< Bumped per job, helpers wait for a change.
+	size_t pending { 0 }; ///< Helpers still working on the current job.
+	bool stopping { false }; ///< Set by the destructor.
+	LoggerFormatFactory* job_formatter { nullptr }; ///< Formatter of the current job.
+	const LogRecord* job_records { nullptr }; ///< Records of the current job.
+	std::string* job_lines { nullptr }; ///< Output of the current job.
+	size_t job_count { 0 }; ///< Records in the current job.
+	size_t job_chunks { 0 }; ///< Chunks the current job is split into, the caller's included.
+};
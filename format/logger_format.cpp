@@ -1,34 +1,79 @@
 #include "logger_format.h"
-#include <sstream>
+#include "logger/logger_registry.h"
+#include <charconv>
 #include <string>
 #include <string_view>
 
 std::string DefLoggerFormatFactory::format(
     const std::string_view message,
     const std::source_location& loc) {
+	return compose(message, &loc,
+	               enable_time ? time_string() : std::string {},
+	               enable_threadid ? thread_string() : std::string {},
+	               loglevel, {},
+	               enable_context ? LogContext::current_text() : std::string_view {}, 1.0f);
+}
+
+std::string DefLoggerFormatFactory::format(const LogRecord& record) {
+	/* custom tools decide what time and thread mean, the producer's stamp and index are only for the defaults */
+	std::string time;
+	std::string thread;
+	if (enable_time) {
+		time = default_tools ? time_string(record) : tools->current_time();
+	}
+	if (enable_threadid) {
+		thread = default_tools ? std::string(ThreadRegistry::label(record.thread_index, enable_osThreadId))
+		                       : tools->thread_id();
+	}
+	return compose(record.message, nullptr, time, thread,
+	               record.level == LogLevel::OFF ? loglevel : record.level,
+	               enable_loggerName ? LoggerRegistry::name_of(record.logger_id) : std::string_view {},
+	               enable_context ? record.context.text() : std::string_view {},
+	               record.sample_rate);
+}
 
-	const std::string_view filename = [&] {
-		const std::string_view full = loc.file_name();
-		const auto pos = full.find_last_of("/\\");
-		return (pos == full.npos) ? full : full.substr(pos + 1);
-	}();
+std::string DefLoggerFormatFactory::compose(
+    std::string_view message,
+    const std::source_location* loc,
+    std::string_view time,
+    std::string_view thread,
+    LogLevel level,
+    std::string_view logger,
+    std::string_view context,
+    float sample_rate) {
 
-	std::ostringstream oss;
+	std::string line;
+	line.reserve(message.size() + 160);
 
 	if (enable_time) {
-		oss << "[" << tools->current_time() << "] ";
+		line.append("[").append(time).append("] ");
 	}
 	if (enable_threadid) {
-		oss << "[th:" << tools->thread_id() << "] ";
+		line.append("[th:").append(thread).append("] ");
 	}
-	oss << "[" << tools->toString(loglevel) << "] ";
-
-	if (enable_srcLocation) {
-		oss << "[" << filename << ":" << loc.line() << "] "
-		    << "[" << loc.function_name() << "] ";
+	line.append("[")
+	    .append(enable_levelPadding ? AbsLoggerTools::toPaddedString(level) : AbsLoggerTools::toString(level))
+	    .append("] ");
+	if (!logger.empty()) {
+		line.append("[").append(logger).append("] ");
+	}
+	if (!context.empty()) {
+		line.append("[").append(context).append("] ");
+	}
+	if (sample_rate < 1.0f) {
+		char number[32];
+		const auto end = std::to_chars(number, number + sizeof(number), sample_rate).ptr;
+		line.append("[sample_rate=").append(number, end).append("] ");
 	}
 
-	oss << ": " << message << "\n";
+	if (enable_srcLocation && loc) {
+		char number[16];
+		const auto end = std::to_chars(number, number + sizeof(number), loc->line()).ptr;
+		line.append("[").append(source_basename(loc->file_name())).append(":");
+		line.append(number, end).append("] ");
+		line.append("[").append(loc->function_name()).append("] ");
+	}
 
-	return oss.str();
-}
+	line.append(": ").append(message).append("\n");
+	return line;
+}
\ No newline at end of file
@@ -5,13 +5,26 @@
 
 #pragma once
 
+#include "cached_queue/log_record.h"
 #include "core/logger_tools.h"
+#include "core/thread_registry.h"
 #include "tools/class_helper.h"
 #include <memory>
 #include <source_location>
 #include <string>
 #include <string_view>
 
+/**
+ * @brief Strips the directories from a source file path.
+ *
+ * @param path A path as returned by std::source_location::file_name().
+ * @return The part after the last '/' or '\\', pointing into path.
+ */
+CCLOGGER_HOT_INLINE constexpr std::string_view source_basename(std::string_view path) noexcept {
+	const auto pos = path.find_last_of("/\\");
+	return (pos == path.npos) ? path : path.substr(pos + 1);
+}
+
 /**
  * @brief Abstract interface for formatting log messages.
  *
@@ -35,6 +48,17 @@ struct LoggerFormatFactory {
 	    const std::string_view message,
 	    const std::source_location& loc = std::source_location::current())
 	    = 0;
+
+	/**
+	 * @brief Formats a queued record, called on the worker thread.
+	 *
+	 * The default forwards the bare message to format(message); override it
+	 * to print what the producer captured in the record, e.g. its thread.
+	 *
+	 * @param record The record taken from the queue.
+	 * @return The formatted log string.
+	 */
+	virtual std::string format(const LogRecord& record) { return format(record.message); }
 };
 
 /**
@@ -44,13 +68,18 @@ struct LoggerFormatFactory {
  * for testing or fallback scenarios.
  */
 struct DummyFormatFactory : public LoggerFormatFactory {
+	using LoggerFormatFactory::format;
+
 	/**
 	 * @copydoc LoggerFormatFactory::format
 	 */
 	virtual std::string format(
 	    const std::string_view message,
-	    const std::source_location& loc = std::source_location::current()) override {
-		return std::string(message.data()) + "\n";
+	    [[maybe_unused]] const std::source_location& loc = std::source_location::current()) override {
+		std::string line;
+		line.reserve(message.size() + 1);
+		line.append(message).push_back('\n');
+		return line;
 	}
 };
 
@@ -62,6 +91,16 @@ struct DummyFormatFactory : public LoggerFormatFactory {
  * - Timestamp inclusion.
  * - Thread ID inclusion.
  * - Source location information.
+ *
+ * For queued records the thread shown is the producer's, resolved from the
+ * record's ThreadRegistry index to the string cached for that thread, and
+ * the time is the producer's LogClock stamp converted only here. Custom
+ * tools are asked for thread_id() and current_time() instead. Queued
+ * records carry no call site, so they print no source location. Records
+ * pushed through a NamedLogger print their own level and the logger's
+ * name; other records print loglevel. The producer's LogScope fields are
+ * printed from the frame the record references, so they cost nothing
+ * until here.
  */
 struct DefLoggerFormatFactory : public LoggerFormatFactory {
 private:
@@ -69,7 +108,50 @@ private:
 	bool enable_time { true }; ///< Flag to include timestamp.
 	bool enable_threadid { true }; ///< Flag to include thread ID.
 	bool enable_srcLocation { true }; ///< Flag to include source location.
+	bool enable_levelPadding { false }; ///< Flag to pad the level name to kLevelNameWidth.
+	bool enable_osThreadId { false }; ///< Flag to show the kernel TID instead of the hashed std::thread::id.
+	bool enable_loggerName { true }; ///< Flag to show the name of the NamedLogger a record came from.
+	bool enable_context { true }; ///< Flag to show the producer's LogScope fields.
 	std::shared_ptr<AbsLoggerTools> tools { new LoggerTools }; ///< Logger utilities for formatting.
+	LoggerTools* default_tools { static_cast<LoggerTools*>(tools.get()) }; ///< tools when it is the final LoggerTools, called without virtual dispatch.
+
+	/**
+	 * @brief Current time from the tools, devirtualized for the default LoggerTools.
+	 */
+	std::string time_string() { return default_tools ? default_tools->current_time() : tools->current_time(); }
+
+	/**
+	 * @brief A record's producer timestamp in calendar time, devirtualized for the default LoggerTools.
+	 */
+	std::string time_string(const LogRecord& record) {
+		const auto tp = LogClock::to_system(record.stamp());
+		return default_tools ? default_tools->format_time(tp) : tools->format_time(tp);
+	}
+
+	/**
+	 * @brief Current thread ID from the tools, devirtualized for the default LoggerTools.
+	 */
+	std::string thread_string() {
+		return default_tools ? std::string(ThreadRegistry::label(ThreadRegistry::current_index(), enable_osThreadId))
+		                     : tools->thread_id();
+	}
+
+	/**
+	 * @brief Builds the line shared by both format overloads.
+	 *
+	 * @param message The raw message.
+	 * @param loc Source location to print when enabled, null when there is none.
+	 * @param time Time string to print when enabled.
+	 * @param thread Thread string to print when enabled.
+	 * @param level Level to print.
+	 * @param logger Logger name to print when not empty.
+	 * @param context LogScope fields to print when not empty.
+	 * @param sample_rate Sampling rate to print when below 1.
+	 */
+	std::string compose(std::string_view message, const std::source_location* loc,
+	                    std::string_view time, std::string_view thread,
+	                    LogLevel level, std::string_view logger, std::string_view context,
+	                    float sample_rate);
 
 public:
 	/**
@@ -93,9 +175,39 @@ public:
 	PROPERTY_GET_SET(enable_srcLocation);
 
 	/**
-	 * @brief Getter and setter for tools.
+	 * @brief Getter and setter for enable_levelPadding.
+	 */
+	PROPERTY_GET_SET(enable_levelPadding);
+
+	/**
+	 * @brief Getter and setter for enable_osThreadId.
+	 */
+	PROPERTY_GET_SET(enable_osThreadId);
+
+	/**
+	 * @brief Getter and setter for enable_loggerName.
+	 */
+	PROPERTY_GET_SET(enable_loggerName);
+
+	/**
+	 * @brief Getter and setter for enable_context.
 	 */
-	PROPERTY_GET_SET(tools);
+	PROPERTY_GET_SET(enable_context);
+
+	/**
+	 * @brief Getter for tools.
+	 */
+	std::shared_ptr<AbsLoggerTools> get_tools() const { return tools; }
+
+	/**
+	 * @brief Setter for tools.
+	 *
+	 * @param _value The new tools, must not be null.
+	 */
+	inline void set_tools(const std::shared_ptr<AbsLoggerTools>& _value) {
+		tools = _value;
+		default_tools = dynamic_cast<LoggerTools*>(tools.get());
+	}
 
 	/**
 	 * @brief Destructor.
@@ -111,4 +223,9 @@ public:
 	virtual std::string format(
 	    const std::string_view message,
 	    const std::source_location& loc = std::source_location::current()) override;
+
+	/**
+	 * @copydoc LoggerFormatFactory::format(const LogRecord&)
+	 */
+	std::string format(const LogRecord& record) override;
 };
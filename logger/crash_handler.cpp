@@ -0,0 +1,186 @@
+#include "crash_handler.h"
+#include "logger/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+constexpr size_t kSignalCount = std::size(kSignals);
+
+struct HandlerState {
+	std::atomic<CCLogger*> watched[CrashHandler::kMaxLoggers] {};
+	std::atomic<int64_t> budget_ns { 0 };
+	std::atomic<bool> saving { false }; ///< Set by the first crash, later ones only wait for it.
+	std::atomic<bool> saved { false }; ///< The first crash finished saving.
+	std::atomic<uint64_t> deadline_ns { 0 }; ///< When the first crash gives up.
+	std::mutex installing; ///< Serializes install() and uninstall().
+	bool installed { false };
+	struct sigaction previous[kSignalCount] {};
+	std::terminate_handler previous_terminate { nullptr };
+	std::unique_ptr<char[]> alt_stack;
+	stack_t previous_stack {};
+};
+
+/* leaked on purpose: a crash may come while static destructors run */
+HandlerState& state() {
+	static HandlerState* instance = new HandlerState;
+	return *instance;
+}
+
+uint64_t monotonic_ns() noexcept {
+	timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * @brief Appends text to buffer at pos, async-signal-safe strcat.
+ */
+size_t append(char* buffer, size_t pos, const char* text) noexcept {
+	while (*text) {
+		buffer[pos++] = *text++;
+	}
+	return pos;
+}
+
+/**
+ * @brief Appends a non negative number to buffer at pos.
+ */
+size_t append(char* buffer, size_t pos, int value) noexcept {
+	char digits[16];
+	size_t count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value > 0 && count < sizeof(digits));
+	while (count > 0) {
+		buffer[pos++] = digits[--count];
+	}
+	return pos;
+}
+
+}
+
+void CrashHandler::install(const CrashPolicy& policy) {
+	auto& handler = state();
+	std::lock_guard<std::mutex> lock(handler.installing);
+	handler.budget_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(policy.budget).count());
+	if (handler.installed) {
+		return;
+	}
+
+	struct sigaction action {};
+	action.sa_sigaction = &CrashHandler::on_signal;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	if (policy.alternate_stack) {
+		const size_t size = std::max<size_t>(SIGSTKSZ, 64 * 1024);
+		handler.alt_stack.reset(new char[size]);
+		stack_t stack {};
+		stack.ss_sp = handler.alt_stack.get();
+		stack.ss_size = size;
+		if (::sigaltstack(&stack, &handler.previous_stack) == 0) {
+			action.sa_flags |= SA_ONSTACK;
+		}
+	}
+	for (size_t i = 0; i < kSignalCount; ++i) {
+		::sigaction(kSignals[i], &action, &handler.previous[i]);
+	}
+	if (policy.catch_terminate) {
+		handler.previous_terminate = std::set_terminate(&CrashHandler::on_terminate);
+	}
+	handler.installed = true;
+}
+
+void CrashHandler::uninstall() {
+	auto& handler = state();
+	std::lock_guard<std::mutex> lock(handler.installing);
+	if (!handler.installed) {
+		return;
+	}
+	for (size_t i = 0; i < kSignalCount; ++i) {
+		::sigaction(kSignals[i], &handler.previous[i], nullptr);
+	}
+	if (std::get_terminate() == &CrashHandler::on_terminate) {
+		std::set_terminate(handler.previous_terminate);
+	}
+	if (handler.alt_stack) {
+		::sigaltstack(&handler.previous_stack, nullptr);
+	}
+	handler.installed = false;
+}
+
+bool CrashHandler::watch(CCLogger& logger) noexcept {
+	for (auto& slot : state().watched) {
+		CCLogger* expected = nullptr;
+		if (slot.compare_exchange_strong(expected, &logger)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void CrashHandler::unwatch(CCLogger& logger) noexcept {
+	for (auto& slot : state().watched) {
+		CCLogger* expected = &logger;
+		slot.compare_exchange_strong(expected, nullptr);
+	}
+}
+
+void CrashHandler::save_all(const char* banner, size_t size) noexcept {
+	auto& handler = state();
+	if (handler.saving.exchange(true)) {
+		/* another thread crashed first, do not kill the process under it */
+		while (!handler.saved.load() && (handler.deadline_ns.load() == 0 || monotonic_ns() < handler.deadline_ns.load())) {
+			::sched_yield();
+		}
+		return;
+	}
+	const uint64_t budget = static_cast<uint64_t>(handler.budget_ns.load());
+	/* backstop for a write that blocks past the budget: SIGALRM ends the process */
+	::alarm(static_cast<unsigned>(budget / 1000000000ull) + 2);
+	const uint64_t deadline = monotonic_ns() + budget;
+	handler.deadline_ns.store(deadline);
+	for (auto& slot : handler.watched) {
+		if (CCLogger* logger = slot.load()) {
+			logger->emergency_drain(banner, size, deadline);
+		}
+	}
+	::alarm(0);
+	handler.saved.store(true);
+}
+
+void CrashHandler::on_signal(int signal, siginfo_t*, void*) {
+	char banner[64];
+	size_t size = append(banner, 0, "CCLogger: fatal signal ");
+	size = append(banner, size, signal);
+	size = append(banner, size, ", saving pending records\n");
+	save_all(banner, size);
+
+	auto& handler = state();
+	for (size_t i = 0; i < kSignalCount; ++i) {
+		if (kSignals[i] == signal) {
+			::sigaction(signal, &handler.previous[i], nullptr);
+		}
+	}
+	/* delivered once we return, to the previous handler or the default action */
+	::raise(signal);
+}
+
+void CrashHandler::on_terminate() {
+	static constexpr char banner[] = "CCLogger: std::terminate called, saving pending records\n";
+	save_all(banner, sizeof(banner) - 1);
+	if (std::terminate_handler previous = state().previous_terminate) {
+		previous();
+	}
+	std::abort();
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+/**
+ * @file crash_handler.h
+ * @brief Opt-in handler that saves pending log records when the process dies on a fatal signal or std::terminate.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+
+class CCLogger;
+
+/**
+ * @brief Tuning of the crash handler.
+ */
+struct CrashPolicy {
+	std::chrono::milliseconds budget { 500 }; ///< Longest time spent saving records before the signal is re-raised.
+	bool catch_terminate { true }; ///< Also hook std::set_terminate.
+	bool alternate_stack { true }; ///< Run the handler on a sigaltstack, so stack overflows in the installing thread are caught too.
+};
+
+/**
+ * @brief Process wide crash handler for the CCLogger instances it watches.
+ *
+ * On SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT or std::terminate it saves,
+ * for every watched logger and in order: what the sink still buffers, the
+ * rest of the batch the worker was writing, and the records still queued.
+ * Only async-signal-safe calls are used: records bypass the formatter and
+ * are written raw (prefixed with kEmergencyPrefix) through
+ * AbstractIO::emergency_write(), locks are only try_lock'ed, and the whole
+ * run is bounded by CrashPolicy::budget (with alarm() as a backstop for a
+ * blocking write). The previous handler is then restored and the signal
+ * re-raised, so core dumps and exit statuses are unchanged.
+ *
+ * A logger that saved records this way is left unusable; the process is
+ * expected to die right after.
+ */
+class CrashHandler {
+public:
+	DISABLE_COPY_MOVE(CrashHandler);
+	CrashHandler() = delete;
+
+	/**
+	 * @brief Installs the signal handlers (and the terminate handler), once per process.
+	 * @param policy The tuning, later calls only update it.
+	 */
+	static void install(const CrashPolicy& policy = {});
+
+	/**
+	 * @brief Restores the handlers that were active before install().
+	 */
+	static void uninstall();
+
+	/**
+	 * @brief Adds a logger to the ones saved on a crash.
+	 * @param logger The logger, unwatched automatically by its destructor.
+	 * @return false if kMaxLoggers loggers are watched already.
+	 */
+	static bool watch(CCLogger& logger) noexcept;
+
+	/**
+	 * @brief Removes a logger from the watch list.
+	 * @param logger The logger.
+	 */
+	static void unwatch(CCLogger& logger) noexcept;
+
+	static constexpr size_t kMaxLoggers = 16; ///< Loggers watched at most.
+	static constexpr const char kEmergencyPrefix[] = "[crash] "; ///< Marks lines written raw by the crash path.
+	static constexpr const char kUnrenderedMessage[] = "<deferred message not rendered>"; ///< Written for a push_deferred() record not rendered yet.
+
+private:
+	static void on_signal(int signal, siginfo_t* info, void* context);
+	static void on_terminate();
+
+	/**
+	 * @brief Saves every watched logger once, later calls return immediately.
+	 * @param banner First line written to each sink.
+	 * @param size Length of banner.
+	 */
+	static void save_all(const char* banner, size_t size) noexcept;
+};
\ No newline at end of file
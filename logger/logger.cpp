@@ -1,80 +1,547 @@
 #include "logger.h"
 #include "IO/io.h"
 #include "cached_queue/logger_queue.h"
+#include "cached_queue/tail_ring.h"
+#include "core/log_clock.h"
+#include "format/format_pool.h"
 #include "format/logger_format.h"
+#include "logger/crash_handler.h"
+#include "logger/logger_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <future>
 #include <memory>
+#include <sched.h>
+#include <system_error>
 #include <thread>
 
-CCLogger::CCLogger(AbstractIO* io) {
+CCLogger::CCLogger(AbstractIO* io, const WaitPolicy& policy, const ThreadPlacement& placement)
+    : wait_policy(policy)
+    , placement(placement) {
 	this->formater = std::make_shared<DummyFormatFactory>();
 	this->io = std::shared_ptr<AbstractIO>(io);
 	this->queue = std::make_shared<LoggerQueue>();
-	worker = std::thread([this]() { this->logging_issue(); });
+	if (placement.is_default()) {
+		worker = std::thread([this]() { this->logging_issue(); });
+		return;
+	}
+
+	/* the worker places itself, nobody can push before the constructor returns */
+	std::promise<int> placed;
+	std::future<int> outcome = placed.get_future();
+	worker = std::thread([this, &placed]() {
+		placed.set_value(this->apply_placement());
+		this->logging_issue();
+	});
+	if (const int error = outcome.get()) {
+		stop_worker();
+		throw std::system_error(error, std::generic_category(), "CCLogger worker placement");
+	}
 }
 
 CCLogger::~CCLogger() {
-	stopFlag.store(true);
+	CrashHandler::unwatch(*this);
+	LoggerRegistry::release_backend(*this);
+	stop_worker();
+}
+
+void CCLogger::stop_worker() {
+	{
+		std::lock_guard<std::mutex> lock(locker);
+		stopFlag.store(true);
+	}
 	notifier.notify_one();
 	if (worker.joinable())
 		worker.join();
 }
 
+int CCLogger::apply_placement() {
+	if (const int error = placement.apply_to_current()) {
+		return error;
+	}
+	if (placement.numa_local_memory) {
+		/* queue and batch swap their slots on every drain, both go to this node */
+		const int node = placement.numa_node();
+		queue->reserve(placement.reserved_slots, node);
+		LoggerQueue::reserve_slots(batch, placement.reserved_slots, node);
+	}
+	return 0;
+}
+
+namespace {
+uint64_t ns_since(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+uint64_t monotonic_ns() noexcept {
+	timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct EmergencySink {
+	AbstractIO* io;
+	uint64_t deadline_ns;
+};
+
+/**
+ * @brief Crash path: writes one record unformatted, async-signal-safe.
+ */
+void emergency_record(const LogRecord& record, void* context) noexcept {
+	const auto* sink = static_cast<const EmergencySink*>(context);
+	if (monotonic_ns() >= sink->deadline_ns) {
+		return;
+	}
+	constexpr size_t prefix = sizeof(CrashHandler::kEmergencyPrefix) - 1;
+	/* running the maker is not async-signal-safe, leave a visible trace of the record instead */
+	const std::string_view text = record.message.deferred() ? std::string_view(CrashHandler::kUnrenderedMessage)
+	                                                        : record.message.view();
+	const bool newline = text.empty() || text.back() != '\n';
+	char line[1024];
+	if (prefix + text.size() + 1 <= sizeof(line)) {
+		std::memcpy(line, CrashHandler::kEmergencyPrefix, prefix);
+		std::memcpy(line + prefix, text.data(), text.size());
+		size_t size = prefix + text.size();
+		if (newline) {
+			line[size++] = '\n';
+		}
+		sink->io->emergency_write(line, size);
+		return;
+	}
+	sink->io->emergency_write(CrashHandler::kEmergencyPrefix, prefix);
+	sink->io->emergency_write(text.data(), text.size());
+	if (newline) {
+		sink->io->emergency_write("\n", 1);
+	}
+}
+}
+
 void CCLogger::push_message(const std::string& raw) {
-	queue->enqueue(raw);
+	counters.on_enqueue(raw.size());
+	wake_worker(queue->enqueue(std::string_view(raw)));
+}
+
+void CCLogger::push_message(std::string&& raw) {
+	counters.on_enqueue(raw.size());
+	if (raw.size() <= LogMessage::kInlineCapacity) {
+		wake_worker(queue->enqueue(std::string_view(raw)));
+		return;
+	}
+	LogRecord record;
+	record.stamp_now();
+	record.message.adopt(std::move(raw));
+	wake_worker(queue->enqueue(std::move(record)));
+}
+
+void CCLogger::push_static(StaticText text, LogLevel level, uint16_t logger_id) {
+	counters.on_enqueue(text.view().size());
+	wake_worker(queue->enqueue_static(text, level, logger_id));
+}
+
+void CCLogger::push_message(std::string_view raw, LogLevel level, uint16_t logger_id) {
+	counters.on_enqueue(raw.size());
+	wake_worker(queue->enqueue(raw, level, logger_id));
+}
+
+void CCLogger::push_record(LogRecord&& record) {
+	counters.on_enqueue(record.message.size());
+	wake_worker(queue->enqueue(std::move(record)));
+}
+
+void CCLogger::push_deferred(LogRecord&& record) {
+	counters.on_enqueue(record.message.size());
+	/* counted before it is queued: a batch holding it sees a nonzero count */
+	if (record.message.deferred()) {
+		deferred_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	wake_worker(queue->enqueue(std::move(record)));
+}
+
+void CCLogger::push_sampled(std::string_view raw, Sample sample, LogLevel level, uint16_t logger_id) {
+	if (sample.rate >= 1.0f) {
+		push_message(raw, level, logger_id);
+		return;
+	}
+	LogRecord record = LogRecord::capture(raw);
+	record.level = level;
+	record.logger_id = logger_id;
+	record.sample_rate = sample.rate;
+	push_record(std::move(record));
+}
+
+bool CCLogger::push_limited(const std::string& raw, const RateLimit& limit, const std::source_location& loc) {
+	auto& site = CallSiteLimiter::at(loc, limit);
+	if (!site.allow()) {
+		return false;
+	}
+	const uint64_t skipped = site.take_suppressed();
+	if (skipped == 0) {
+		push_message(raw);
+	} else {
+		counters.on_suppressed(skipped);
+		push_message(std::format("{} ({} similar messages suppressed)", raw, skipped));
+	}
+	return true;
+}
+
+LoggerStats CCLogger::stats() const {
+	return counters.snapshot(queue->approx_size());
+}
+
+void CCLogger::wake_worker(size_t pending) {
+	const size_t threshold = wake_threshold.load();
+	if (threshold == 0 || pending < threshold) {
+		return;
+	}
+	/* the worker holds locker from publishing the threshold until it sleeps */
+	{ std::lock_guard<std::mutex> lock(locker); }
 	notifier.notify_one();
 }
 
-void CCLogger::flush() {
+uint64_t CCLogger::request_flush() {
+	uint64_t ticket;
 	{
 		std::lock_guard<std::mutex> lock(locker);
-		flushRequest = true;
+		ticket = ++flush_requested;
 	}
 	notifier.notify_one();
+	return ticket;
+}
+
+void CCLogger::flush() {
+	request_flush();
 }
 
 void CCLogger::sync_flush() {
+	const uint64_t ticket = request_flush();
+	std::unique_lock<std::mutex> lock(flush_locker);
+	flush_cv.wait(lock, [this, ticket]() { return flush_completed.load() >= ticket; });
+}
+
+CCLogger::FlushAwaiter CCLogger::flush_async() {
+	return FlushAwaiter(*this, request_flush());
+}
+
+CCLogger::FlushAwaiter CCLogger::push_durable(const std::string& raw) {
+	push_message(raw);
+	return flush_async();
+}
+
+void CCLogger::set_resume_hook(ResumeHook hook) {
+	std::lock_guard<std::mutex> lock(flush_locker);
+	resume_hook = std::move(hook);
+}
+
+bool CCLogger::FlushAwaiter::await_ready() const noexcept {
+	return logger.flush_completed.load() >= ticket;
+}
+
+bool CCLogger::FlushAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	std::lock_guard<std::mutex> lock(logger.flush_locker);
+	if (logger.flush_completed.load() >= ticket) {
+		return false;
+	}
+	logger.flush_waiters.emplace_back(ticket, handle);
+	return true;
+}
+
+void CCLogger::complete_flush(uint64_t ticket) {
+	std::vector<std::coroutine_handle<>> ready;
+	ResumeHook hook;
 	{
-		std::lock_guard<std::mutex> lock(locker);
-		flushRequest = true;
-		flushFinish = false;
+		std::lock_guard<std::mutex> lock(flush_locker);
+		flush_completed.store(ticket);
+		auto served = std::partition(flush_waiters.begin(), flush_waiters.end(),
+		                             [ticket](const auto& waiter) { return waiter.first > ticket; });
+		for (auto it = served; it != flush_waiters.end(); ++it) {
+			ready.push_back(it->second);
+		}
+		flush_waiters.erase(served, flush_waiters.end());
+		hook = resume_hook;
 	}
-	notifier.notify_one();
+	flush_cv.notify_all();
 
-	std::unique_lock<std::mutex> lock(flush_locker);
-	flush_cv.wait(lock, [this]() { return flushFinish.load(); });
+	for (auto handle : ready) {
+		if (hook) {
+			hook(handle);
+		} else {
+			handle.resume();
+		}
+	}
 }
 
-void CCLogger::logging_issue() {
-	while (1) {
-		std::unique_lock<std::mutex> lock(locker);
-		notifier.wait(lock, [this]() { return stopFlag.load() || !queue->empty() || flushRequest; });
+void CCLogger::park(size_t threshold, std::chrono::microseconds timeout) {
+	std::unique_lock<std::mutex> lock(locker);
+	/* publish before checking the queue, producers check in the opposite order */
+	wake_threshold.store(threshold);
+	auto ready = [this, threshold]() {
+		return stopFlag.load() || flush_pending() || queue->approx_size() >= threshold;
+	};
+	if (timeout.count() > 0) {
+		notifier.wait_for(lock, timeout, ready);
+	} else {
+		notifier.wait(lock, ready);
+	}
+	wake_threshold.store(0);
+}
 
-		if (stopFlag.load() && queue->empty()) {
-			break;
+void CCLogger::wait_for_records() {
+	auto ready = [this]() {
+		return stopFlag.load() || flush_pending() || queue->approx_size() > 0;
+	};
+
+	switch (wait_policy.strategy) {
+	case WaitStrategy::BusySpin:
+		while (!ready()) {
+			cpu_relax();
+		}
+		return;
+	case WaitStrategy::SpinYield:
+		for (uint32_t i = 0; i < wait_policy.spin_rounds; ++i) {
+			if (ready())
+				return;
+			cpu_relax();
+		}
+		for (uint32_t i = 0; i < wait_policy.yield_rounds; ++i) {
+			if (ready())
+				return;
+			std::this_thread::yield();
+		}
+		park(1);
+		return;
+	case WaitStrategy::TimedBatch:
+		park(1);
+		if (stopFlag.load() || flush_pending()) {
+			return;
 		}
+		/* first record is in, give the batch some time to fill up */
+		park(std::max<size_t>(wait_policy.batch_threshold, 1), wait_policy.batch_interval);
+		return;
+	case WaitStrategy::Blocking:
+	default:
+		park(1);
+		return;
+	}
+}
 
-		auto write_sessions = queue->current_left();
-		queue->clear();
-		lock.unlock();
+void CCLogger::write_record(const LogRecord& record) {
+	const auto format_begin = std::chrono::steady_clock::now();
+	const std::string line = formater->format(record);
+	const auto write_begin = std::chrono::steady_clock::now();
+	write_line(line, record.level);
+	const auto write_end = std::chrono::steady_clock::now();
+	counters.format_ns.record(ns_since(format_begin, write_begin));
+	counters.write_ns.record(ns_since(write_begin, write_end));
+	counters.on_write(line.size());
+}
 
-		for (const auto& each : write_sessions) {
-			io->write_logger(formater->format(each));
+void CCLogger::write_batch_parallel() {
+	formatted.resize(batch.size());
+	format_pool->format(*formater, batch.data(), batch.size(), formatted.data());
+	const uint64_t format_ns = format_pool->busy_ns() / batch.size();
+	for (size_t i = 0; i < batch.size(); batch_written.store(++i, std::memory_order_release)) {
+		halt_if_crashing();
+		const auto write_begin = std::chrono::steady_clock::now();
+		write_line(formatted[i], batch[i].level);
+		counters.format_ns.record(format_ns);
+		counters.write_ns.record(ns_since(write_begin, std::chrono::steady_clock::now()));
+		counters.on_write(formatted[i].size());
+	}
+}
+
+void CCLogger::render_deferred() {
+	size_t rendered = 0;
+	for (auto& record : batch) {
+		if (record.message.deferred()) {
+			record.message.render();
+			++rendered;
 		}
+	}
+	deferred_pending.fetch_sub(rendered, std::memory_order_relaxed);
+}
 
-		lock.lock();
-		if (flushRequest) {
-			io->force_flush();
-			flushRequest = false;
+void CCLogger::write_line(const std::string& line, LogLevel level) {
+	io->write_leveled(line, level);
+	if (TailRing* ring = tail.load(std::memory_order_acquire)) {
+		ring->push(line);
+	}
+}
+
+void CCLogger::reconfigure(AbstractIO* new_io, LoggerFormatFactory* new_formatter) {
+	{
+		std::lock_guard<std::mutex> lock(reconfigure_locker);
+		if (new_io != nullptr) {
+			pending_io.reset(new_io);
+		}
+		if (new_formatter != nullptr) {
+			pending_formatter.reset(new_formatter);
+		}
+		reconfigure_pending.store(true, std::memory_order_release);
+	}
+	/* a flush ticket wakes an idle worker, which swaps first and flushes the new IO */
+	request_flush();
+}
+
+void CCLogger::apply_reconfigure() {
+	std::shared_ptr<AbstractIO> next_io;
+	std::shared_ptr<LoggerFormatFactory> next_formatter;
+	{
+		std::lock_guard<std::mutex> lock(reconfigure_locker);
+		next_io = std::move(pending_io);
+		next_formatter = std::move(pending_formatter);
+		reconfigure_pending.store(false, std::memory_order_relaxed);
+	}
+	if (next_io) {
+		/* the pending summary belongs to the old output, in the old format */
+		report_repeats();
+		io->force_flush();
+		io = std::move(next_io);
+	}
+	if (next_formatter) {
+		formater = std::move(next_formatter);
+	}
+}
+
+void CCLogger::reserve_queue(size_t slots) {
+	queue->reserve(slots);
+}
+
+TailRing& CCLogger::enable_tail(size_t capacity) {
+	std::lock_guard<std::mutex> lock(locker);
+	if (!tail_ring) {
+		tail_ring = std::make_unique<TailRing>(capacity);
+	}
+	tail.store(tail_ring.get(), std::memory_order_release);
+	return *tail_ring;
+}
+
+void CCLogger::report_repeats() {
+	if (repeat_count == 0) {
+		return;
+	}
+	last_repeat.message.assign(std::format("last message repeated {} times", repeat_count));
+	write_record(last_repeat);
+	repeat_count = 0;
+}
+
+bool CCLogger::repeats_last_written(const LogRecord& record) const {
+	return record.message == last_written && record.level == last_level && record.logger_id == last_logger_id
+	    && record.context.get() == last_context.get() && record.sample_rate == last_sample_rate;
+}
+
+void CCLogger::remember_written(const LogRecord& record) {
+	last_written.assign(record.message.view());
+	last_level = record.level;
+	last_logger_id = record.logger_id;
+	last_sample_rate = record.sample_rate;
+	last_context = record.context;
+}
+
+void CCLogger::halt_for_crash() {
+	worker_halted.store(true);
+	while (true) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+}
+
+void CCLogger::emergency_drain(const char* banner, size_t size, uint64_t deadline_ns) noexcept {
+	crash_halt.store(true);
+	const bool on_worker = std::this_thread::get_id() == worker.get_id();
+	/* give the worker half the budget to reach a record boundary and halt there */
+	const uint64_t settle_ns = monotonic_ns() + (deadline_ns - std::min(deadline_ns, monotonic_ns())) / 2;
+	while (!on_worker && worker_busy.load() && !worker_halted.load() && monotonic_ns() < settle_ns) {
+		::sched_yield();
+	}
+
+	EmergencySink sink { io.get(), deadline_ns };
+	/* a worker stuck inside the IO still owns its buffer and batch, only the queue is safe then */
+	if (on_worker || !worker_busy.load() || worker_halted.load()) {
+		io->emergency_flush();
+		io->emergency_write(banner, size);
+		/* the record the worker crashed on is skipped, it may be what crashed it */
+		for (size_t i = batch_written.load(std::memory_order_acquire) + (on_worker ? 1 : 0); i < batch.size(); ++i) {
+			emergency_record(batch[i], &sink);
+		}
+	} else {
+		io->emergency_write(banner, size);
+	}
+	queue->emergency_visit(&emergency_record, &sink, deadline_ns);
+}
+
+void CCLogger::logging_issue() {
+	while (1) {
+		wait_for_records();
+
+		/* publish before checking crash_halt, the crash path checks in the opposite order */
+		worker_busy.store(true);
+		halt_if_crashing();
 
-			if (!flushFinish) {
-				lock.unlock();
-				{
-					std::lock_guard<std::mutex> f_lock(flush_locker);
-					flushFinish = true;
+		/* read the ticket before draining: whatever was pushed before it is in this batch */
+		const uint64_t flush_target = flush_requested.load();
+		/* after the ticket: a flush requested after reconfigure() completes with the new IO */
+		const bool swapping = reconfigure_pending.load(std::memory_order_acquire);
+		queue->drain(batch);
+		if (deferred_pending.load(std::memory_order_relaxed) != 0) [[unlikely]] {
+			render_deferred();
+		}
+		batch_written.store(0, std::memory_order_release);
+		counters.on_batch(batch.size());
+		LogClock::calibrate_if_due();
+		const bool collapse = collapse_repeats.load(std::memory_order_relaxed);
+		if (const size_t helpers = format_threads.load(std::memory_order_relaxed);
+		    helpers != (format_pool ? format_pool->helpers() : 0)) {
+			format_pool = helpers == 0 ? nullptr : std::make_unique<FormatPool>(helpers, placement);
+		}
+		if (format_pool && !collapse && batch.size() >= 2 * FormatPool::kMinChunk) {
+			report_repeats();
+			write_batch_parallel();
+		}
+		for (size_t i = batch_written.load(std::memory_order_relaxed); i < batch.size(); batch_written.store(++i, std::memory_order_release)) {
+			halt_if_crashing();
+			LogRecord& each = batch[i];
+			if (collapse && repeats_last_written(each)) {
+				if (repeat_count++ == 0) {
+					repeat_since = std::chrono::steady_clock::now();
 				}
-				flush_cv.notify_one();
-				lock.lock();
+				last_repeat = std::move(each);
+				counters.on_collapsed();
+				continue;
+			}
+			report_repeats();
+			write_record(each);
+			if (collapse) {
+				remember_written(each);
 			}
 		}
+		if (!collapse) {
+			last_written.clear();
+			last_context = {};
+		}
+
+		const bool flushing = flush_target != flush_completed.load();
+		if (repeat_count > 0
+		    && (flushing || stopFlag.load() || std::chrono::steady_clock::now() - repeat_since >= kRepeatReportInterval)) {
+			report_repeats();
+		}
+		io->end_batch();
+		/* after the batch: what was pushed before reconfigure() went out with the old IO and formatter */
+		if (swapping) [[unlikely]] {
+			apply_reconfigure();
+		}
+
+		if (flushing) {
+			const auto fsync_begin = std::chrono::steady_clock::now();
+			io->force_flush();
+			counters.fsync_ns.record(ns_since(fsync_begin, std::chrono::steady_clock::now()));
+			complete_flush(flush_target);
+		}
+		worker_busy.store(false);
+
+		if (stopFlag.load() && queue->approx_size() == 0 && !flush_pending()) {
+			break;
+		}
 	}
-}
+}
\ No newline at end of file
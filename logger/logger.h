@@ -5,16 +5,32 @@
 
 #pragma once
 
+#include "core/thread_placement.h"
 #include "format/logger_format.h"
+#include "logger/logger_stats.h"
+#include "logger/rate_limit.h"
+#include "logger/sampling.h"
+#include "logger/wait_policy.h"
 #include "tools/class_helper.h"
+#include <atomic>
 #include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
+#include <vector>
 
+class FormatPool;
 class LoggerFormatFactory;
 class AbstractIO;
 class LoggerQueue;
+class TailRing;
 
 /**
  * @brief CCLogger is a high-performance logger supporting both asynchronous and synchronous flushing.
@@ -24,14 +40,54 @@ class LoggerQueue;
  */
 class CCLogger {
 public:
+	/**
+	 * @brief Awaitable returned by flush_async() and push_durable().
+	 *
+	 * Completes once everything pushed before the request has been written
+	 * and force flushed. It never blocks the awaiting thread: the coroutine is
+	 * resumed by the worker thread, or handed to the resume hook if one is set.
+	 */
+	class [[nodiscard]] FlushAwaiter {
+	public:
+		/**
+		 * @brief Skips suspension when the flush has already completed.
+		 */
+		bool await_ready() const noexcept;
+
+		/**
+		 * @brief Registers the coroutine to be resumed on flush completion.
+		 * @return false if the flush completed meanwhile, so the caller just continues.
+		 */
+		bool await_suspend(std::coroutine_handle<> handle);
+
+		void await_resume() const noexcept { }
+
+	private:
+		friend class CCLogger;
+		FlushAwaiter(CCLogger& logger, uint64_t ticket)
+		    : logger(logger)
+		    , ticket(ticket) { }
+
+		CCLogger& logger; ///< The logger that owns the flush.
+		uint64_t ticket; ///< The flush request this awaiter waits for.
+	};
+
+	/**
+	 * @brief Callback that takes over resuming coroutines, e.g. posting them to an executor.
+	 */
+	using ResumeHook = std::function<void(std::coroutine_handle<>)>;
+
 	DISABLE_COPY_MOVE(CCLogger);
 	CCLogger() = delete;
 
 	/**
 	 * @brief Constructs the logger with a specified output interface.
 	 * @param io A pointer to an AbstractIO implementation for actual output (e.g., file, console).
+	 * @param policy How the worker thread waits for new messages, see WaitPolicy.
+	 * @param placement CPUs, scheduling and NUMA node of the worker thread, see ThreadPlacement.
+	 * @throw std::system_error if the worker could not be placed as asked, e.g. a CPU that does not exist.
 	 */
-	explicit CCLogger(AbstractIO* io);
+	explicit CCLogger(AbstractIO* io, const WaitPolicy& policy = {}, const ThreadPlacement& placement = {});
 
 	/**
 	 * @brief Destructor. Ensures that the worker thread stops and resources are properly released.
@@ -44,6 +100,106 @@ public:
 	 */
 	void push_message(const std::string& raw);
 
+	/**
+	 * @brief Pushes a message the caller gives up, without copying long ones.
+	 *
+	 * A message that fits LogMessage's inline buffer is copied into its queue
+	 * slot as usual; a longer one keeps its heap buffer, which moves through
+	 * the queue and is freed after it is written.
+	 * @param raw The log message to enqueue.
+	 */
+	void push_message(std::string&& raw);
+
+	/**
+	 * @brief Pushes static text by pointer and length, without copying it.
+	 *
+	 * @code
+	 * logger.push_static("connection accepted");
+	 * logger.push_static(StaticText::from_static(kBanner), LogLevel::INFO);
+	 * @endcode
+	 * @param text A string literal, or StaticText::from_static() of a view that outlives the logger.
+	 * @param level The level it was logged at, OFF for none.
+	 * @param logger_id The LoggerRegistry id of the named logger, 0 for none.
+	 */
+	void push_static(StaticText text, LogLevel level = LogLevel::OFF, uint16_t logger_id = 0);
+
+	/**
+	 * @brief Pushes a message tagged with its level and the named logger it came from.
+	 *
+	 * This is what NamedLogger handles feed their shared backend with; the
+	 * formatter prints the level and the logger's name from the record.
+	 * @param raw The log message to enqueue.
+	 * @param level The level it was logged at.
+	 * @param logger_id The LoggerRegistry id of the named logger, 0 for none.
+	 */
+	void push_message(std::string_view raw, LogLevel level, uint16_t logger_id = 0);
+
+	/**
+	 * @brief Pushes a record captured earlier, keeping its thread, time and context.
+	 *
+	 * Used to replay records kept aside, e.g. a BacktraceRing dump.
+	 * @param record The record to enqueue.
+	 */
+	void push_record(LogRecord&& record);
+
+	/**
+	 * @brief Pushes a message that was kept by a sampling draw, recording its rate.
+	 *
+	 * Draw first (Sampler::draw(), SampledSite::draw()) and build the
+	 * message only when the draw keeps it. The formatter prints the rate as
+	 * "[sample_rate=0.01]" when it is below 1.
+	 * @param raw The log message to enqueue.
+	 * @param sample The draw that kept it.
+	 * @param level The level it was logged at, OFF for none.
+	 * @param logger_id The LoggerRegistry id of the named logger, 0 for none.
+	 */
+	void push_sampled(std::string_view raw, Sample sample, LogLevel level = LogLevel::OFF, uint16_t logger_id = 0);
+
+	/**
+	 * @brief Pushes a callable that builds the message, run by the worker instead of the caller.
+	 *
+	 * The producer only stamps the record and moves the callable into its
+	 * queue slot; building the text (dumping a container, to_string of a
+	 * large object) moves off the hot path. Capture by value: the callable
+	 * runs after this returns. One that does not fit the slot, or is not
+	 * copyable and nothrow movable (see LogMessage::kDeferrable), runs here.
+	 * If the process crashes while the record is still queued, the crash
+	 * path writes CrashHandler::kUnrenderedMessage in its place, since it
+	 * cannot run the callable.
+	 * @code
+	 * logger.push_deferred([snapshot = state] { return describe(snapshot); }, LogLevel::DEBUG);
+	 * @endcode
+	 * @param maker Returns the message, e.g. a std::string.
+	 * @param level The level it was logged at, OFF for none.
+	 * @param logger_id The LoggerRegistry id of the named logger, 0 for none.
+	 * @param sample The draw that kept it, see push_sampled().
+	 */
+	template <TextMaker F>
+	void push_deferred(F&& maker, LogLevel level = LogLevel::OFF, uint16_t logger_id = 0, Sample sample = {}) {
+		LogRecord record;
+		record.stamp_now();
+		record.message.defer(std::forward<F>(maker));
+		record.level = level;
+		record.logger_id = logger_id;
+		record.sample_rate = sample.rate;
+		push_deferred(std::move(record));
+	}
+
+	/**
+	 * @brief Pushes a message unless its call site is over its rate limit.
+	 *
+	 * Each call site (file, line and column of the caller) gets its own
+	 * CallSiteLimiter, created with limit on first use. A refused message
+	 * costs one atomic operation; the next message let through is suffixed
+	 * with how many were suppressed in between.
+	 * @param raw The log message to enqueue.
+	 * @param limit The policy of this call site.
+	 * @param loc The call site, leave defaulted.
+	 * @return Whether the message was enqueued.
+	 */
+	bool push_limited(const std::string& raw, const RateLimit& limit,
+	                  const std::source_location& loc = std::source_location::current());
+
 	/**
 	 * @brief Asynchronously requests to flush the current log buffer.
 	 *
@@ -58,6 +214,29 @@ public:
 	 */
 	void sync_flush();
 
+	/**
+	 * @brief Awaitable flush for coroutine based callers.
+	 *
+	 * Same guarantee as sync_flush(), but `co_await logger.flush_async()`
+	 * suspends the coroutine instead of parking the thread.
+	 */
+	FlushAwaiter flush_async();
+
+	/**
+	 * @brief Pushes a message and returns an awaitable that completes once it is persisted.
+	 * @param raw The log message to enqueue.
+	 */
+	FlushAwaiter push_durable(const std::string& raw);
+
+	/**
+	 * @brief Sets who resumes coroutines waiting on a flush.
+	 *
+	 * By default they are resumed inline on the worker thread, which stalls logging
+	 * for as long as the coroutine runs. Executors should post the handle instead.
+	 * @param hook The hook, an empty function restores the default.
+	 */
+	void set_resume_hook(ResumeHook hook);
+
 	/**
 	 * @brief Gets the current logger format factory.
 	 * @return A pointer to the current LoggerFormatFactory.
@@ -72,7 +251,119 @@ public:
 	 */
 	inline void set_formattor(LoggerFormatFactory* fmtFactory) { formater.reset(fmtFactory); }
 
+	/**
+	 * @brief Replaces the output and/or the formatter while the logger runs.
+	 *
+	 * Unlike set_formattor(), safe to call at any time: the worker first
+	 * writes the records already queued with the old components, then the
+	 * pending repeat summaries, flushes the old IO and takes the new ones,
+	 * so every line goes whole to one of them. Producers keep pushing
+	 * meanwhile; a sync_flush() started after this returns completes once
+	 * the swap is done.
+	 * @param new_io The new output, owned by the logger, nullptr keeps the current one.
+	 * @param new_formatter The new formatter, owned by the logger, nullptr keeps the current one.
+	 */
+	void reconfigure(AbstractIO* new_io, LoggerFormatFactory* new_formatter);
+
+	/**
+	 * @brief Allocates queue slots up front, so the queue does not grow on the hot path.
+	 *
+	 * @param slots Records the queue holds without reallocating.
+	 */
+	void reserve_queue(size_t slots);
+
+	/**
+	 * @brief Gets the wait policy the worker thread was started with.
+	 */
+	const WaitPolicy& get_wait_policy() const { return wait_policy; }
+
+	/**
+	 * @brief Gets the placement the worker thread was started with.
+	 */
+	const ThreadPlacement& get_placement() const { return placement; }
+
+	/**
+	 * @brief Makes the worker fold consecutive identical messages.
+	 *
+	 * Repeats of the last written message, with the same level, named
+	 * logger, LogScope fields and sampling rate, are counted instead of written,
+	 * and reported as one "last message repeated N times" line when a
+	 * different message arrives, on flush, on shutdown, or once the pending
+	 * repeats are older than kRepeatReportInterval.
+	 * @param enable Whether to collapse repeats, off by default.
+	 */
+	void set_collapse_repeats(bool enable) { collapse_repeats.store(enable, std::memory_order_relaxed); }
+
+	/**
+	 * @brief Whether consecutive identical messages are collapsed.
+	 */
+	bool get_collapse_repeats() const { return collapse_repeats.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Formats large batches on helper threads, see FormatPool.
+	 *
+	 * For when the worker is CPU bound on formatting rich lines. Batches of
+	 * at least 2 * FormatPool::kMinChunk records are split into chunks that
+	 * are formatted in parallel, then written by the worker in their
+	 * original order. The formatter must be safe to call concurrently.
+	 * Batches are formatted on the worker alone while repeats are collapsed.
+	 * The helpers run with the worker's ThreadPlacement.
+	 * The worker applies the setting before its next batch.
+	 * @param helpers Formatting threads besides the worker, 0 (the default) for none.
+	 */
+	void set_format_threads(size_t helpers) { format_threads.store(helpers, std::memory_order_relaxed); }
+
+	/**
+	 * @brief Formatting threads besides the worker.
+	 */
+	size_t get_format_threads() const { return format_threads.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Starts keeping the last lines written in a TailRing, for live inspection.
+	 *
+	 * Readers call snapshot() on the returned ring from any thread; it never
+	 * blocks the worker or producers, unlike LoggerQueue::current_left().
+	 * Calling it again returns the ring in use. The ring stays valid as long
+	 * as the logger, even after disable_tail().
+	 * @param capacity Lines kept, used when the ring is created.
+	 * @return The ring.
+	 */
+	TailRing& enable_tail(size_t capacity = 1024);
+
+	/**
+	 * @brief Stops copying lines into the ring.
+	 */
+	void disable_tail() { tail.store(nullptr, std::memory_order_release); }
+
+	/**
+	 * @brief The ring lines are copied into, nullptr when disabled.
+	 */
+	TailRing* get_tail() const { return tail.load(std::memory_order_acquire); }
+
+	static constexpr std::chrono::seconds kRepeatReportInterval { 1 }; ///< Longest delay of a repeat summary while messages keep coming.
+
+	/**
+	 * @brief Takes a snapshot of the logger's self-instrumentation counters.
+	 *
+	 * Cheap enough to poll from a metrics exporter; it never blocks producers
+	 * or the worker.
+	 * @return A copy of the counters at about this point in time.
+	 */
+	LoggerStats stats() const;
+
 private:
+	friend class CrashHandler;
+
+	/**
+	 * @brief Enqueues a record built by push_deferred(), telling the worker to render it.
+	 */
+	void push_deferred(LogRecord&& record);
+
+	/**
+	 * @brief Worker side: runs the deferred makers of the drained batch.
+	 */
+	void render_deferred();
+
 	/**
 	 * @brief The main logging loop for the worker thread.
 	 *
@@ -80,15 +371,148 @@ private:
 	 */
 	void logging_issue();
 
+	/**
+	 * @brief Worker side: applies the placement to the worker and places the queue memory.
+	 * @return 0 or the errno of the setting that failed.
+	 */
+	int apply_placement();
+
+	/**
+	 * @brief Stops and joins the worker thread.
+	 */
+	void stop_worker();
+
+	/**
+	 * @brief Blocks the worker according to the wait policy until there is work.
+	 */
+	void wait_for_records();
+
+	/**
+	 * @brief Parks the worker on the notifier until threshold messages are pending.
+	 *
+	 * @param threshold Pending count at which producers wake the worker.
+	 * @param timeout Gives up after this long, zero waits forever.
+	 */
+	void park(size_t threshold, std::chrono::microseconds timeout = {});
+
+	/**
+	 * @brief Producer side: signals the worker only if it is parked and wants this many.
+	 * @param pending Queue size right after the producer's enqueue.
+	 */
+	void wake_worker(size_t pending);
+
+	/**
+	 * @brief Worker side: formats and writes one record, with timing.
+	 */
+	void write_record(const LogRecord& record);
+
+	/**
+	 * @brief Worker side: formats the batch on the format pool, then writes it in order.
+	 */
+	void write_batch_parallel();
+
+	/**
+	 * @brief Worker side: hands a written line, with its record's level, to the IO and to the tail ring, if any.
+	 */
+	void write_line(const std::string& line, LogLevel level);
+
+	/**
+	 * @brief Worker side: swaps in the components passed to reconfigure().
+	 */
+	void apply_reconfigure();
+
+	/**
+	 * @brief Worker side: writes the pending "last message repeated N times" line, if any.
+	 */
+	void report_repeats();
+
+	/**
+	 * @brief Worker side: whether a record repeats the last written one: same text, level, logger, scope and sampling.
+	 */
+	bool repeats_last_written(const LogRecord& record) const;
+
+	/**
+	 * @brief Worker side: remembers a written record for repeats_last_written().
+	 */
+	void remember_written(const LogRecord& record);
+
+	/**
+	 * @brief Worker side: parks the worker for good once a crash handler took over.
+	 */
+	CCLOGGER_HOT_INLINE void halt_if_crashing() {
+		if (crash_halt.load(std::memory_order_relaxed)) [[unlikely]] {
+			halt_for_crash();
+		}
+	}
+
+	[[noreturn]] void halt_for_crash();
+
+	/**
+	 * @brief Crash path, see CrashHandler: writes the sink's buffer, the rest of
+	 *        the current batch and the queued records with async-signal-safe calls only.
+	 *
+	 * @param banner First line to write.
+	 * @param size Length of banner.
+	 * @param deadline_ns CLOCK_MONOTONIC time to give up at.
+	 */
+	void emergency_drain(const char* banner, size_t size, uint64_t deadline_ns) noexcept;
+
+	/**
+	 * @brief Takes a new flush ticket and wakes the worker for it.
+	 * @return The ticket, done once flush_completed reaches it.
+	 */
+	uint64_t request_flush();
+
+	/**
+	 * @brief Worker side: publishes a finished flush and wakes everyone waiting for it.
+	 * @param ticket The latest ticket covered by the flush.
+	 */
+	void complete_flush(uint64_t ticket);
+
+	/**
+	 * @brief Checks whether a flush request has not been served yet.
+	 */
+	bool flush_pending() const { return flush_requested.load() != flush_completed.load(); }
+
 	std::shared_ptr<LoggerFormatFactory> formater {}; ///< Formatter for log messages.
 	std::shared_ptr<AbstractIO> io; ///< Output interface.
 	std::shared_ptr<LoggerQueue> queue; ///< Queue holding log messages.
+	WaitPolicy wait_policy; ///< How the worker waits for messages.
+	ThreadPlacement placement; ///< Where the worker runs.
+	LoggerCounters counters; ///< Self-instrumentation, see stats().
+	std::atomic<size_t> wake_threshold { 0 }; ///< Pending count the parked worker waits for, 0 when awake.
 	std::condition_variable notifier; ///< Notifier for new log messages or flush requests.
 	std::condition_variable flush_cv; ///< Notifier for flush completion in synchronous flush.
 	std::mutex locker; ///< Mutex to protect queue and flags.
 	std::mutex flush_locker; ///< Mutex to protect flush waiting logic.
 	std::thread worker; ///< Worker thread for asynchronous logging.
 	std::atomic<bool> stopFlag; ///< Flag to stop the worker thread.
-	std::atomic<bool> flushRequest; ///< Flag indicating a flush request.
-	std::atomic<bool> flushFinish { true }; ///< Flag indicating flush completion for sync flush.
+	std::atomic<uint64_t> flush_requested { 0 }; ///< Latest flush ticket handed out.
+	std::atomic<uint64_t> flush_completed { 0 }; ///< Latest flush ticket served by the worker.
+	std::vector<std::pair<uint64_t, std::coroutine_handle<>>> flush_waiters; ///< Coroutines awaiting a ticket, guarded by flush_locker.
+	ResumeHook resume_hook; ///< Optional resumer of flush waiters, guarded by flush_locker.
+	std::vector<LogRecord> batch; ///< Worker only: the records being written, also read by the crash path.
+	std::atomic<size_t> batch_written { 0 }; ///< Records of batch already handed to the IO.
+	std::atomic<bool> worker_busy { false }; ///< The worker is between draining and finishing a batch.
+	std::atomic<bool> crash_halt { false }; ///< Set by the crash path, the worker stops at the next record.
+	std::atomic<bool> worker_halted { false }; ///< The worker stopped for the crash path.
+	std::atomic<bool> collapse_repeats { false }; ///< See set_collapse_repeats().
+	std::atomic<size_t> format_threads { 0 }; ///< See set_format_threads().
+	std::unique_ptr<FormatPool> format_pool; ///< Worker only: the pool matching format_threads, if any.
+	std::vector<std::string> formatted; ///< Worker only: lines of the batch formatted by format_pool.
+	std::atomic<TailRing*> tail { nullptr }; ///< See enable_tail(), written to by the worker only.
+	std::unique_ptr<TailRing> tail_ring; ///< Owns the ring enable_tail() created, guarded by locker.
+	std::atomic<size_t> deferred_pending { 0 }; ///< Deferred records pushed and not rendered yet.
+	std::atomic<bool> reconfigure_pending { false }; ///< reconfigure() left components for the worker.
+	std::mutex reconfigure_locker; ///< Guards pending_io and pending_formatter.
+	std::shared_ptr<AbstractIO> pending_io; ///< Next output, see reconfigure().
+	std::shared_ptr<LoggerFormatFactory> pending_formatter; ///< Next formatter, see reconfigure().
+	std::string last_written; ///< Worker only: raw text of the last written message.
+	LogLevel last_level { LogLevel::OFF }; ///< Worker only: level of the last written record.
+	uint16_t last_logger_id { 0 }; ///< Worker only: named logger of the last written record.
+	float last_sample_rate { 1.0f }; ///< Worker only: sampling rate of the last written record.
+	LogContext::Ref last_context; ///< Worker only: LogScope frame of the last written record, kept alive so its address is not reused.
+	LogRecord last_repeat; ///< Worker only: the latest repeat folded, stamps the summary line.
+	uint64_t repeat_count { 0 }; ///< Worker only: repeats folded since the last summary.
+	std::chrono::steady_clock::time_point repeat_since; ///< Worker only: when the first pending repeat arrived.
 };
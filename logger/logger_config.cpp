@@ -0,0 +1,396 @@
+#include "logger_config.h"
+#include "IO/consoleio.h"
+#include "IO/fileio.h"
+#include "IO/socketio.h"
+#include "format/logger_format.h"
+#include "logger/logger.h"
+#include "logger/logger_registry.h"
+#include "logger/sampling.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+	const auto begin = text.find_first_not_of(" \t\r");
+	if (begin == text.npos) {
+		return {};
+	}
+	return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+[[noreturn]] void bad_value(std::string_view key, std::string_view value) {
+	throw std::invalid_argument("bad value '" + std::string(value) + "' for '" + std::string(key) + "'");
+}
+
+bool parse_bool(std::string_view key, std::string_view value) {
+	if (value == "true" || value == "on" || value == "yes" || value == "1") {
+		return true;
+	}
+	if (value == "false" || value == "off" || value == "no" || value == "0") {
+		return false;
+	}
+	bad_value(key, value);
+}
+
+LogLevel parse_level(std::string_view key, std::string_view value) {
+	const auto level = AbsLoggerTools::tryFromString(value);
+	if (!level) {
+		bad_value(key, value);
+	}
+	return *level;
+}
+
+size_t parse_size(std::string_view key, std::string_view value) {
+	size_t number = 0;
+	const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+	if (error != std::errc {} || end != value.data() + value.size()) {
+		bad_value(key, value);
+	}
+	return number;
+}
+
+double parse_rate(std::string_view key, std::string_view value) {
+	double rate = 0;
+	const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), rate);
+	if (error != std::errc {} || end != value.data() + value.size() || rate < 0.0 || rate > 1.0) {
+		bad_value(key, value);
+	}
+	return rate;
+}
+
+bool valid_sink(std::string_view sink) {
+	if (sink == "console") {
+		return true;
+	}
+	for (const std::string_view prefix : { "file:", "unix:", "unix-stream:" }) {
+		if (sink.starts_with(prefix)) {
+			return sink.size() > prefix.size();
+		}
+	}
+	if (sink.starts_with("udp:")) {
+		const auto colon = sink.rfind(':');
+		return colon > 4 && colon + 1 < sink.size();
+	}
+	return false;
+}
+
+}
+
+LoggerConfig LoggerConfig::parse(std::string_view text) {
+	LoggerConfig config;
+	std::string section;
+	size_t line_number = 0;
+	while (!text.empty()) {
+		const auto end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == text.npos ? text.size() : end + 1);
+		++line_number;
+
+		/* '#' and ';' inside a value (file:/var/log/a;b.log) are not comments, only at the start or after blanks */
+		for (size_t i = 0; i < line.size(); ++i) {
+			if ((line[i] == '#' || line[i] == ';') && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) {
+				line = line.substr(0, i);
+				break;
+			}
+		}
+		line = trim(line);
+		if (line.empty()) {
+			continue;
+		}
+		try {
+			if (line.front() == '[') {
+				if (line.back() != ']') {
+					throw std::invalid_argument("unterminated section '" + std::string(line) + "'");
+				}
+				section = trim(line.substr(1, line.size() - 2));
+				continue;
+			}
+			const auto equals = line.find('=');
+			if (equals == line.npos) {
+				throw std::invalid_argument("expected 'key = value', got '" + std::string(line) + "'");
+			}
+			const std::string_view key = trim(line.substr(0, equals));
+			config.set(section.empty() ? std::string(key) : section + "." + std::string(key), trim(line.substr(equals + 1)));
+		} catch (const std::invalid_argument& e) {
+			throw std::invalid_argument("line " + std::to_string(line_number) + ": " + e.what());
+		}
+	}
+	return config;
+}
+
+LoggerConfig LoggerConfig::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::system_error(errno, std::generic_category(), "cannot read " + path);
+	}
+	std::ostringstream content;
+	content << file.rdbuf();
+	try {
+		return parse(content.str());
+	} catch (const std::invalid_argument& e) {
+		throw std::invalid_argument(path + ": " + e.what());
+	}
+}
+
+void LoggerConfig::set(std::string_view key, std::string_view value) {
+	if (key == "sink") {
+		if (!valid_sink(value)) {
+			bad_value(key, value);
+		}
+		sink = value;
+	} else if (key == "console.color") {
+		if (value != "auto" && value != "always" && value != "never") {
+			bad_value(key, value);
+		}
+		console_color = value;
+	} else if (key == "console.stderr_level") {
+		console_stderr_level = parse_level(key, value);
+	} else if (key == "level") {
+		level = parse_level(key, value);
+	} else if (key == "format.level") {
+		format_level = parse_level(key, value);
+	} else if (key == "format.time") {
+		format_time = parse_bool(key, value);
+	} else if (key == "format.thread") {
+		format_thread = parse_bool(key, value);
+	} else if (key == "format.source") {
+		format_source = parse_bool(key, value);
+	} else if (key == "format.padding") {
+		format_padding = parse_bool(key, value);
+	} else if (key == "format.os_thread_id") {
+		format_os_thread_id = parse_bool(key, value);
+	} else if (key == "format.logger_name") {
+		format_logger_name = parse_bool(key, value);
+	} else if (key == "format.context") {
+		format_context = parse_bool(key, value);
+	} else if (key.starts_with("logger.") && key.size() > 7) {
+		const std::string name(key.substr(7));
+		const LogLevel logger_level = parse_level(key, value);
+		const auto same = std::find_if(logger_levels.begin(), logger_levels.end(),
+		                               [&name](const auto& entry) { return entry.first == name; });
+		if (same != logger_levels.end()) {
+			same->second = logger_level;
+		} else {
+			logger_levels.emplace_back(name, logger_level);
+		}
+	} else if (key.starts_with("sample.")) {
+		const auto sampled = AbsLoggerTools::tryFromString(key.substr(7));
+		if (!sampled || *sampled == LogLevel::OFF) {
+			throw std::invalid_argument("unknown level in '" + std::string(key) + "'");
+		}
+		sample_rates[Weight(*sampled)] = parse_rate(key, value);
+	} else if (key == "worker.format_threads") {
+		format_threads = parse_size(key, value);
+	} else if (key == "worker.collapse_repeats") {
+		collapse_repeats = parse_bool(key, value);
+	} else if (key == "queue.reserve") {
+		queue_reserve = parse_size(key, value);
+	} else {
+		throw std::invalid_argument("unknown key '" + std::string(key) + "'");
+	}
+}
+
+void LoggerConfig::apply_env() {
+	const char* options = std::getenv("CCLOGGER_OPTIONS");
+	if (options == nullptr) {
+		return;
+	}
+	std::string_view rest(options);
+	while (!rest.empty()) {
+		const auto end = rest.find(';');
+		const std::string_view entry = trim(rest.substr(0, end));
+		rest.remove_prefix(end == rest.npos ? rest.size() : end + 1);
+		if (entry.empty()) {
+			continue;
+		}
+		const auto equals = entry.find('=');
+		if (equals == entry.npos) {
+			throw std::invalid_argument("CCLOGGER_OPTIONS: expected 'key=value', got '" + std::string(entry) + "'");
+		}
+		set(trim(entry.substr(0, equals)), trim(entry.substr(equals + 1)));
+	}
+}
+
+AbstractIO* LoggerConfig::make_sink() const {
+	const std::string_view spec = sink;
+	if (spec == "console") {
+		ConsoleOptions options;
+		options.color = console_color == "always" ? ColorMode::Always
+		              : console_color == "never"  ? ColorMode::Never
+		                                          : ColorMode::Auto;
+		options.stderr_level = console_stderr_level;
+		return new FastConsoleIO(options);
+	}
+	if (spec.starts_with("file:")) {
+		return new FileIO(std::string(spec.substr(5)));
+	}
+	if (spec.starts_with("unix:")) {
+		return new SocketIO(SocketEndpoint::unix_datagram(std::string(spec.substr(5))));
+	}
+	if (spec.starts_with("unix-stream:")) {
+		return new SocketIO(SocketEndpoint::unix_stream(std::string(spec.substr(12))));
+	}
+	if (spec.starts_with("udp:") && valid_sink(spec)) {
+		const auto colon = spec.rfind(':');
+		const size_t port = parse_size("sink", spec.substr(colon + 1));
+		if (port == 0 || port > 65535) {
+			bad_value("sink", spec);
+		}
+		return new SocketIO(SocketEndpoint::udp(std::string(spec.substr(4, colon - 4)), static_cast<uint16_t>(port)));
+	}
+	bad_value("sink", spec);
+}
+
+LoggerFormatFactory* LoggerConfig::make_formatter() const {
+	auto* format = new DefLoggerFormatFactory;
+	format->set_loglevel(format_level);
+	format->set_enable_time(format_time);
+	format->set_enable_threadid(format_thread);
+	format->set_enable_srcLocation(format_source);
+	format->set_enable_levelPadding(format_padding);
+	format->set_enable_osThreadId(format_os_thread_id);
+	format->set_enable_loggerName(format_logger_name);
+	format->set_enable_context(format_context);
+	return format;
+}
+
+bool LoggerConfig::same_sink(const LoggerConfig& other) const noexcept {
+	return sink == other.sink && console_color == other.console_color
+	    && console_stderr_level == other.console_stderr_level;
+}
+
+void LoggerConfig::apply(CCLogger& logger, const LoggerConfig* previous) const {
+	/* build what can fail first, so a bad sink changes nothing */
+	std::unique_ptr<AbstractIO> next_io(previous == nullptr || !same_sink(*previous) ? make_sink() : nullptr);
+	std::unique_ptr<LoggerFormatFactory> next_formatter(make_formatter());
+
+	for (size_t i = 0; i + 1 < kLogLevelCount; ++i) {
+		Sampler::set_rate(static_cast<LogLevel>(i), sample_rates[i]);
+	}
+	LoggerRegistry::root().set_level(level);
+	if (previous != nullptr) {
+		for (const auto& [name, unused] : previous->logger_levels) {
+			const bool kept = std::any_of(logger_levels.begin(), logger_levels.end(),
+			                              [&name](const auto& entry) { return entry.first == name; });
+			if (!kept) {
+				LoggerRegistry::get(name).clear_level();
+			}
+		}
+	}
+	for (const auto& [name, logger_level] : logger_levels) {
+		LoggerRegistry::get(name).set_level(logger_level);
+	}
+	logger.set_format_threads(format_threads);
+	logger.set_collapse_repeats(collapse_repeats);
+	if (queue_reserve > 0) {
+		logger.reserve_queue(queue_reserve);
+	}
+	logger.reconfigure(next_io.release(), next_formatter.release());
+	logger.sync_flush();
+}
+
+ConfigWatcher::ConfigWatcher(CCLogger& logger, std::string path)
+    : logger(logger)
+    , path(std::move(path)) {
+	applied = LoggerConfig::load(this->path);
+	applied.apply_env();
+	applied.apply(logger);
+	reload_count.store(1, std::memory_order_release);
+
+	/* watch the directory: editors often replace the file instead of writing it */
+	const auto slash = this->path.rfind('/');
+	const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : this->path.substr(0, slash);
+	inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1 || ::inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+		const int error_code = errno;
+		if (inotify_fd != -1) {
+			::close(inotify_fd);
+		}
+		throw std::system_error(error_code, std::generic_category(), "cannot watch " + directory);
+	}
+	stop_fd = ::eventfd(0, EFD_CLOEXEC);
+	if (stop_fd == -1) {
+		const int error_code = errno;
+		::close(inotify_fd);
+		throw std::system_error(error_code, std::generic_category(), "eventfd");
+	}
+	watcher = std::thread([this]() { watch(); });
+}
+
+ConfigWatcher::~ConfigWatcher() {
+	const uint64_t one = 1;
+	[[maybe_unused]] const auto written = ::write(stop_fd, &one, sizeof(one));
+	watcher.join();
+	::close(stop_fd);
+	::close(inotify_fd);
+}
+
+bool ConfigWatcher::reload() {
+	std::lock_guard<std::mutex> lock(locker);
+	try {
+		LoggerConfig next = LoggerConfig::load(path);
+		next.apply_env();
+		next.apply(logger, &applied);
+		applied = std::move(next);
+		error.clear();
+		reload_count.fetch_add(1, std::memory_order_release);
+		return true;
+	} catch (const std::exception& e) {
+		error = e.what();
+		return false;
+	}
+}
+
+std::string ConfigWatcher::last_error() const {
+	std::lock_guard<std::mutex> lock(locker);
+	return error;
+}
+
+LoggerConfig ConfigWatcher::current() const {
+	std::lock_guard<std::mutex> lock(locker);
+	return applied;
+}
+
+void ConfigWatcher::watch() {
+	const auto slash = path.rfind('/');
+	const std::string_view name = slash == std::string::npos ? std::string_view(path) : std::string_view(path).substr(slash + 1);
+	alignas(inotify_event) char events[4096];
+	while (true) {
+		pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+		if (::poll(fds, 2, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		if (fds[1].revents != 0) {
+			return;
+		}
+		bool changed = false;
+		ssize_t size;
+		while ((size = ::read(inotify_fd, events, sizeof(events))) > 0) {
+			for (const char* at = events; at < events + size;) {
+				const auto* event = reinterpret_cast<const inotify_event*>(at);
+				if (event->len > 0 && std::string_view(event->name) == name) {
+					changed = true;
+				}
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+		if (changed) {
+			reload();
+		}
+	}
+}
@@ -0,0 +1,217 @@
+/**
+ * @file logger_config.h
+ * @brief Declarative logger setup from a file or the environment, with inotify based hot reload.
+ */
+
+#pragma once
+
+#include "core/logger_tools.h"
+#include "tools/class_helper.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class AbstractIO;
+class CCLogger;
+struct LoggerFormatFactory;
+
+/**
+ * @brief What a config file describes: the sink, the format, levels, sampling and worker knobs.
+ *
+ * The format is INI like, one "key = value" per line, '#' or ';' at the
+ * start of a line or after a blank starts a comment (so "file:a;b.log" is
+ * kept whole) and "[section]" prefixes the keys below it with "section.":
+ *
+ * @code
+ * sink = file:/var/log/app.log     # console, file:<path>, unix:<path>, unix-stream:<path>, udp:<host>:<port>
+ * level = INFO                     # level of the root named logger
+ *
+ * [format]
+ * time = true
+ * thread = true
+ * source = false
+ * level = INFO                     # printed for records pushed without a level
+ *
+ * [logger]
+ * net.http = DEBUG                 # level of one named logger
+ *
+ * [sample]
+ * TRACE = 0.01                     # Sampler rate of a level
+ *
+ * [worker]
+ * format_threads = 2
+ * collapse_repeats = true
+ *
+ * [queue]
+ * reserve = 8192                   # slots allocated up front
+ * @endcode
+ *
+ * Keys left out keep their defaults, so removing a line from a watched file
+ * undoes it on the next reload.
+ */
+struct LoggerConfig {
+	std::string sink { "console" }; ///< Where lines go, see make_sink().
+	std::string console_color { "auto" }; ///< console: auto, always or never.
+	LogLevel console_stderr_level { LogLevel::ERROR }; ///< console: lines at or above go to stderr.
+	LogLevel level { LogLevel::INFO }; ///< Level of the LoggerRegistry root.
+	LogLevel format_level { LogLevel::INFO }; ///< DefLoggerFormatFactory::loglevel.
+	bool format_time { true }; ///< DefLoggerFormatFactory::enable_time.
+	bool format_thread { true }; ///< DefLoggerFormatFactory::enable_threadid.
+	bool format_source { true }; ///< DefLoggerFormatFactory::enable_srcLocation.
+	bool format_padding { false }; ///< DefLoggerFormatFactory::enable_levelPadding.
+	bool format_os_thread_id { false }; ///< DefLoggerFormatFactory::enable_osThreadId.
+	bool format_logger_name { true }; ///< DefLoggerFormatFactory::enable_loggerName.
+	bool format_context { true }; ///< DefLoggerFormatFactory::enable_context.
+	std::vector<std::pair<std::string, LogLevel>> logger_levels; ///< Levels of named loggers, in file order.
+	std::array<double, kLogLevelCount> sample_rates; ///< Sampler rate per level, 1 by default.
+	size_t format_threads { 0 }; ///< CCLogger::set_format_threads().
+	bool collapse_repeats { false }; ///< CCLogger::set_collapse_repeats().
+	size_t queue_reserve { 0 }; ///< Queue slots allocated up front, 0 leaves the queue alone.
+
+	LoggerConfig() { sample_rates.fill(1.0); }
+
+	/**
+	 * @brief Parses config text on top of the defaults.
+	 *
+	 * @param text The file content.
+	 * @return The config.
+	 * @throws std::invalid_argument naming the line of an unknown key or a bad value.
+	 */
+	static LoggerConfig parse(std::string_view text);
+
+	/**
+	 * @brief Reads and parses a config file.
+	 *
+	 * @param path The file.
+	 * @return The config.
+	 * @throws std::system_error if the file cannot be read, std::invalid_argument as parse().
+	 */
+	static LoggerConfig load(const std::string& path);
+
+	/**
+	 * @brief Applies one "key = value" setting.
+	 *
+	 * @param key The full key, e.g. "format.time".
+	 * @param value The value, trimmed.
+	 * @throws std::invalid_argument for an unknown key or a bad value.
+	 */
+	void set(std::string_view key, std::string_view value);
+
+	/**
+	 * @brief Overrides settings from the CCLOGGER_OPTIONS environment variable.
+	 *
+	 * It holds "key=value" entries separated by ';', e.g.
+	 * CCLOGGER_OPTIONS="level=DEBUG;format.source=false", and wins over the file.
+	 * @throws std::invalid_argument as set().
+	 */
+	void apply_env();
+
+	/**
+	 * @brief Creates the sink described by sink.
+	 *
+	 * @return A new IO, owned by the caller.
+	 * @throws std::invalid_argument for an unknown sink.
+	 */
+	AbstractIO* make_sink() const;
+
+	/**
+	 * @brief Creates a DefLoggerFormatFactory with the format settings.
+	 *
+	 * @return A new formatter, owned by the caller.
+	 */
+	LoggerFormatFactory* make_formatter() const;
+
+	/**
+	 * @brief Applies the config to a running logger without pausing producers.
+	 *
+	 * Levels and sampling rates are atomics and change at once; the sink and
+	 * the formatter are handed to CCLogger::reconfigure() and swapped in by
+	 * the worker between two batches. The sink is only replaced when its
+	 * settings differ from previous. Records pushed before this call are
+	 * written with the old sink and format. Returns once the worker uses
+	 * the new ones, so records pushed afterwards get the new config.
+	 *
+	 * @param logger The logger.
+	 * @param previous The config applied before, nullptr for the first time.
+	 */
+	void apply(CCLogger& logger, const LoggerConfig* previous = nullptr) const;
+
+	/**
+	 * @brief Whether make_sink() of both would write to the same place the same way.
+	 */
+	bool same_sink(const LoggerConfig& other) const noexcept;
+};
+
+/**
+ * @brief Applies a config file to a logger, and again every time the file changes.
+ *
+ * A helper thread watches the file's directory with inotify, so editors that
+ * replace the file (write a temporary, rename it over) are seen too. A file
+ * that fails to parse is reported by last_error() and leaves the running
+ * config untouched. The CCLOGGER_OPTIONS overrides are applied on every load.
+ */
+class ConfigWatcher {
+public:
+	DISABLE_COPY_MOVE(ConfigWatcher);
+	ConfigWatcher() = delete;
+
+	/**
+	 * @brief Loads and applies the file, then starts watching it.
+	 *
+	 * @param logger The logger to configure, must outlive the watcher.
+	 * @param path The config file.
+	 * @throws std::system_error or std::invalid_argument if the first load fails.
+	 */
+	ConfigWatcher(CCLogger& logger, std::string path);
+
+	/**
+	 * @brief Stops and joins the watching thread.
+	 */
+	~ConfigWatcher();
+
+	/**
+	 * @brief Reloads the file now, as if it had changed.
+	 *
+	 * @return Whether the file parsed and was applied.
+	 */
+	bool reload();
+
+	/**
+	 * @brief Successful loads so far, the first one included.
+	 */
+	uint64_t reloads() const noexcept { return reload_count.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Why the last load failed, empty if it succeeded.
+	 */
+	std::string last_error() const;
+
+	/**
+	 * @brief The config currently applied.
+	 */
+	LoggerConfig current() const;
+
+private:
+	/**
+	 * @brief Loop of the watching thread.
+	 */
+	void watch();
+
+	CCLogger& logger; ///< The logger configured.
+	const std::string path; ///< The config file.
+	mutable std::mutex locker; ///< Guards applied and error, and serializes reloads.
+	LoggerConfig applied; ///< The config in effect.
+	std::string error; ///< See last_error().
+	std::atomic<uint64_t> reload_count { 0 }; ///< See reloads().
+	int inotify_fd { -1 }; ///< Watches the directory of path.
+	int stop_fd { -1 }; ///< eventfd that wakes the thread to exit.
+	std::thread watcher; ///< Runs watch().
+};
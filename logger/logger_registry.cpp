@@ -0,0 +1,143 @@
+#include "logger_registry.h"
+#include <array>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct RegistryState {
+	std::array<std::atomic<NamedLogger*>, LoggerRegistry::kMaxLoggers> loggers {};
+	size_t count { 0 }; ///< Loggers created, ids below it are taken; guarded by locker.
+	std::unordered_map<std::string_view, NamedLogger*> by_name; ///< Keys view the loggers' own names.
+	std::mutex locker; ///< Serializes creation and level changes.
+	std::vector<std::unique_ptr<BacktraceRing>> rings; ///< Owns every backtrace ring ever enabled.
+};
+
+/* leaked on purpose: handles may still log while static destructors run */
+RegistryState& state() {
+	static RegistryState* instance = new RegistryState;
+	return *instance;
+}
+
+}
+
+NamedLogger* LoggerRegistry::intern(std::string_view name, NamedLogger* parent) {
+	auto& registry = state();
+	if (const auto it = registry.by_name.find(name); it != registry.by_name.end()) {
+		return it->second;
+	}
+	if (registry.count >= kMaxLoggers) {
+		throw std::length_error("too many named loggers");
+	}
+	const auto id = static_cast<uint16_t>(registry.count);
+	auto* logger = new NamedLogger(std::string(name), id, parent);
+	if (parent == nullptr) {
+		logger->own = kDefaultLevel;
+	}
+	logger->threshold.store(Weight(parent == nullptr ? kDefaultLevel : parent->level()), std::memory_order_relaxed);
+	registry.by_name.emplace(logger->name, logger);
+	registry.loggers[id].store(logger, std::memory_order_release);
+	++registry.count;
+	return logger;
+}
+
+NamedLogger& LoggerRegistry::get(std::string_view name) {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	/* walk "net", "net.http", ... so every ancestor exists and has the lower id */
+	NamedLogger* logger = intern({}, nullptr);
+	for (size_t end = 0; end < name.size(); ++end) {
+		end = std::min(name.find('.', end), name.size());
+		logger = intern(name.substr(0, end), logger);
+	}
+	return *logger;
+}
+
+NamedLogger& LoggerRegistry::root() {
+	return get({});
+}
+
+std::string_view LoggerRegistry::name_of(uint16_t id) noexcept {
+	if (id >= kMaxLoggers) {
+		return {};
+	}
+	const NamedLogger* logger = state().loggers[id].load(std::memory_order_acquire);
+	return logger == nullptr ? std::string_view {} : std::string_view(logger->name);
+}
+
+void LoggerRegistry::set_backend(CCLogger* backend) noexcept {
+	shared_backend.store(backend, std::memory_order_release);
+}
+
+void LoggerRegistry::release_backend(CCLogger& backend) noexcept {
+	CCLogger* expected = &backend;
+	shared_backend.compare_exchange_strong(expected, nullptr);
+}
+
+void LoggerRegistry::propagate_levels() {
+	auto& registry = state();
+	/* parents have lower ids, so one pass in id order sees every parent settled */
+	for (size_t id = 0; id < registry.count; ++id) {
+		NamedLogger* logger = registry.loggers[id].load(std::memory_order_relaxed);
+		const LogLevel level = logger->own ? *logger->own : logger->parent->level();
+		logger->threshold.store(Weight(level), std::memory_order_relaxed);
+	}
+}
+
+void NamedLogger::set_level(LogLevel level) {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	own = level;
+	LoggerRegistry::propagate_levels();
+}
+
+void NamedLogger::clear_level() {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	own = parent == nullptr ? std::optional<LogLevel>(LoggerRegistry::kDefaultLevel) : std::nullopt;
+	LoggerRegistry::propagate_levels();
+}
+
+std::optional<LogLevel> NamedLogger::own_level() const {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	return own;
+}
+
+void NamedLogger::enable_backtrace(size_t capacity, LogLevel dump_level) {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	/* superseded rings stay alive, a producer may still be pushing into one */
+	registry.rings.push_back(std::make_unique<BacktraceRing>(capacity));
+	backtrace.store(registry.rings.back().get(), std::memory_order_release);
+	dump_threshold.store(Weight(dump_level), std::memory_order_relaxed);
+}
+
+void NamedLogger::disable_backtrace() {
+	auto& registry = state();
+	std::lock_guard<std::mutex> lock(registry.locker);
+	backtrace.store(nullptr, std::memory_order_release);
+	dump_threshold.store(Weight(LogLevel::OFF), std::memory_order_relaxed);
+}
+
+size_t NamedLogger::dump_backtrace() {
+	BacktraceRing* ring = backtrace.load(std::memory_order_acquire);
+	CCLogger* backend = LoggerRegistry::backend();
+	if (ring == nullptr || backend == nullptr) {
+		return 0;
+	}
+	std::vector<LogRecord> records;
+	if (ring->collect(records) == 0) {
+		return 0;
+	}
+	backend->push_message(std::format("---- backtrace: last {} messages of {} ----", records.size(), name), LogLevel::INFO, id);
+	for (auto& record : records) {
+		backend->push_record(std::move(record));
+	}
+	backend->push_message(std::format("---- end of backtrace of {} ----", name), LogLevel::INFO, id);
+	return records.size();
+}
@@ -0,0 +1,355 @@
+/**
+ * @file logger_registry.h
+ * @brief Defines the process wide registry of named, hierarchical loggers that share one CCLogger backend.
+ */
+
+#pragma once
+
+#include "cached_queue/backtrace_ring.h"
+#include "core/logger_tools.h"
+#include "logger/logger.h"
+#include "tools/class_helper.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief Marks a text maker to be run by the worker thread instead of the caller, see on_worker().
+ */
+template <typename F>
+struct OnWorker {
+	F maker; ///< The callable, capturing by value.
+};
+
+/**
+ * @brief Wraps a text maker so NamedLogger::log() hands it to the worker, see CCLogger::push_deferred().
+ *
+ * @code
+ * http.debug(on_worker([headers] { return dump(headers); }));
+ * @endcode
+ */
+template <TextMaker F>
+OnWorker<std::decay_t<F>> on_worker(F&& maker) {
+	return { std::forward<F>(maker) };
+}
+
+/**
+ * @brief Lightweight handle of a named logger, e.g. "net.http".
+ *
+ * A handle owns no thread and no queue: log() checks the level against one
+ * relaxed atomic and hands the message to the registry's backend, tagged
+ * with the logger's interned id. The level is inherited from the nearest
+ * ancestor ("net" for "net.http") that has one set, down from the root.
+ * Handles live as long as the process; keep the reference that
+ * LoggerRegistry::get() returns.
+ *
+ * With enable_backtrace(), messages below the level are kept in a
+ * BacktraceRing instead of being dropped, and replayed in front of the
+ * next message at or above the dump level (or on dump_backtrace()).
+ *
+ * Every log() also takes a callable instead of the text, run only when the
+ * message is logged (or kept for the backtrace), so costly arguments are
+ * not built for nothing: http.debug([&] { return dump(headers); }). Wrapped
+ * in on_worker(), it runs on the worker thread; the CCLOGGER_DEBUG() style
+ * macros do the same for std::format arguments.
+ */
+class NamedLogger {
+public:
+	DISABLE_COPY_MOVE(NamedLogger);
+	NamedLogger() = delete;
+
+	/**
+	 * @brief Whether a message at level would be logged, one relaxed load.
+	 */
+	CCLOGGER_HOT_INLINE bool enabled(LogLevel level) const noexcept {
+		const auto weight = Weight(level);
+		return weight >= threshold.load(std::memory_order_relaxed) && weight < Weight(LogLevel::OFF);
+	}
+
+	/**
+	 * @brief Pushes a message to the shared backend if level is enabled.
+	 *
+	 * The message is subject to the level's Sampler rate; sampled lines
+	 * carry the rate they were kept with.
+	 * @param level The level of the message, not OFF.
+	 * @param message The log message.
+	 * @return false if the level is disabled, the message was sampled out or no backend is set.
+	 */
+	bool log(LogLevel level, std::string_view message);
+
+	/**
+	 * @brief log() with the text built by maker, on the calling thread, only if it is logged.
+	 *
+	 * @param level The level of the message, not OFF.
+	 * @param maker Returns the message; not called when the message is dropped.
+	 * @return As log().
+	 */
+	template <TextMaker F>
+	bool log(LogLevel level, F&& maker);
+
+	/**
+	 * @brief log() with the text built by the worker thread, only if it is logged.
+	 *
+	 * A message kept for the backtrace is built right away instead.
+	 * @param level The level of the message, not OFF.
+	 * @param deferred The maker, see on_worker().
+	 * @return As log().
+	 */
+	template <typename F>
+	bool log(LogLevel level, OnWorker<F> deferred);
+
+	template <typename Text>
+	bool trace(Text&& message) { return log(LogLevel::TRACE, std::forward<Text>(message)); } ///< log() at TRACE.
+	template <typename Text>
+	bool debug(Text&& message) { return log(LogLevel::DEBUG, std::forward<Text>(message)); } ///< log() at DEBUG.
+	template <typename Text>
+	bool info(Text&& message) { return log(LogLevel::INFO, std::forward<Text>(message)); } ///< log() at INFO.
+	template <typename Text>
+	bool warn(Text&& message) { return log(LogLevel::WARN, std::forward<Text>(message)); } ///< log() at WARN.
+	template <typename Text>
+	bool error(Text&& message) { return log(LogLevel::ERROR, std::forward<Text>(message)); } ///< log() at ERROR.
+	template <typename Text>
+	bool fatal(Text&& message) { return log(LogLevel::FATAL, std::forward<Text>(message)); } ///< log() at FATAL.
+
+	/**
+	 * @brief Sets this logger's own level, inherited by descendants without one.
+	 *
+	 * @param level The minimum level logged, OFF disables the subtree.
+	 */
+	void set_level(LogLevel level);
+
+	/**
+	 * @brief Drops this logger's own level, it inherits its parent's again.
+	 *
+	 * The root keeps LoggerRegistry::kDefaultLevel instead.
+	 */
+	void clear_level();
+
+	/**
+	 * @brief Keeps the last messages below the level in memory, to be written when something fails.
+	 *
+	 * @param capacity Messages kept.
+	 * @param dump_level Messages at or above it dump the ring first.
+	 */
+	void enable_backtrace(size_t capacity, LogLevel dump_level = LogLevel::ERROR);
+
+	/**
+	 * @brief Stops keeping messages below the level; what the ring holds is discarded.
+	 */
+	void disable_backtrace();
+
+	/**
+	 * @brief Writes the kept messages now, oldest first, between two marker lines.
+	 *
+	 * @return How many kept messages were written, 0 without a backend or ring.
+	 */
+	size_t dump_backtrace();
+
+	/**
+	 * @brief The level in effect, own or inherited.
+	 */
+	LogLevel level() const noexcept { return static_cast<LogLevel>(threshold.load(std::memory_order_relaxed)); }
+
+	/**
+	 * @brief The level set on this logger itself, if any.
+	 */
+	std::optional<LogLevel> own_level() const;
+
+	const std::string& get_name() const { return name; } ///< Full dotted name, empty for the root.
+	uint16_t get_id() const { return id; } ///< Interned id carried by records, 0 for the root.
+	NamedLogger* get_parent() const { return parent; } ///< Parent logger, null for the root.
+
+private:
+	friend class LoggerRegistry;
+
+	/**
+	 * @brief The backend to push an enabled message to, after the sampling
+	 *        draw and any backtrace dump; null if the message is dropped.
+	 */
+	CCLogger* admit(LogLevel level, Sample& sample);
+
+	/**
+	 * @brief Keeps a message below the level in the backtrace ring, if there is one.
+	 *
+	 * @return Whether the ring took it.
+	 */
+	bool keep_for_backtrace(LogLevel level, std::string_view message) {
+		BacktraceRing* ring = backtrace.load(std::memory_order_acquire);
+		if (ring == nullptr || level == LogLevel::OFF) {
+			return false;
+		}
+		ring->push(message, level, id);
+		return true;
+	}
+
+	NamedLogger(std::string name, uint16_t id, NamedLogger* parent)
+	    : name(std::move(name))
+	    , id(id)
+	    , parent(parent) { }
+
+	const std::string name; ///< Full dotted name.
+	const uint16_t id; ///< Index in the registry.
+	NamedLogger* const parent; ///< Parent logger, null for the root.
+	std::optional<LogLevel> own; ///< Level set on this logger, guarded by the registry lock.
+	std::atomic<uint8_t> threshold { Weight(LogLevel::INFO) }; ///< Weight of the effective level.
+	std::atomic<BacktraceRing*> backtrace { nullptr }; ///< Ring of messages below the level, null when off.
+	std::atomic<uint8_t> dump_threshold { Weight(LogLevel::OFF) }; ///< Weight of the level that dumps the ring.
+};
+
+/**
+ * @brief Process wide table of named loggers and the backend they feed.
+ *
+ * get("net.http") creates "net" and "net.http" on first use and returns the
+ * same handle afterwards. Names are interned to 16 bit ids once, so records
+ * carry only the id and the formatter resolves it with name_of() on the
+ * worker thread. All handles share one CCLogger, set with set_backend(), so
+ * any number of components cost a single worker thread. Lookups by id are
+ * lock free; creating loggers and changing levels take a lock.
+ */
+class LoggerRegistry {
+public:
+	DISABLE_COPY_MOVE(LoggerRegistry);
+	LoggerRegistry() = delete;
+
+	static constexpr size_t kMaxLoggers = 4096; ///< Cap of named loggers, the root included.
+	static constexpr LogLevel kDefaultLevel = LogLevel::INFO; ///< Level of the root until set.
+
+	/**
+	 * @brief Returns the logger of a dotted name, creating it and its ancestors on first use.
+	 *
+	 * @param name E.g. "db.pool"; the empty name is the root.
+	 * @return The handle, valid for the life of the process.
+	 * @throw std::length_error if kMaxLoggers loggers exist already.
+	 */
+	static NamedLogger& get(std::string_view name);
+
+	/**
+	 * @brief The root logger, ancestor of every other.
+	 */
+	static NamedLogger& root();
+
+	/**
+	 * @brief The full name of an interned id, lock free.
+	 *
+	 * @param id A NamedLogger::get_id() value.
+	 * @return The name, empty for the root or an unknown id. The view stays
+	 *         valid for the life of the process.
+	 */
+	static std::string_view name_of(uint16_t id) noexcept;
+
+	/**
+	 * @brief Sets the logger all handles push to.
+	 *
+	 * @param backend The shared logger, owned by the caller; it clears itself
+	 *        from here on destruction. Null makes every handle drop its messages.
+	 */
+	static void set_backend(CCLogger* backend) noexcept;
+
+	/**
+	 * @brief The logger all handles push to, null if none is set.
+	 */
+	static CCLogger* backend() noexcept { return shared_backend.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Unsets backend if it is the current one, called by ~CCLogger().
+	 */
+	static void release_backend(CCLogger& backend) noexcept;
+
+private:
+	friend class NamedLogger;
+
+	/**
+	 * @brief Returns the logger of name, creating it under parent if missing; caller holds the lock.
+	 */
+	static NamedLogger* intern(std::string_view name, NamedLogger* parent);
+
+	/**
+	 * @brief Recomputes every effective level after a change, caller holds the lock.
+	 */
+	static void propagate_levels();
+
+	static inline std::atomic<CCLogger*> shared_backend { nullptr }; ///< See set_backend().
+};
+
+inline CCLogger* NamedLogger::admit(LogLevel level, Sample& sample) {
+	CCLogger* backend = LoggerRegistry::backend();
+	if (backend == nullptr) {
+		return nullptr;
+	}
+	sample = Sampler::draw(level);
+	if (!sample) {
+		return nullptr;
+	}
+	if (Weight(level) >= dump_threshold.load(std::memory_order_relaxed)) [[unlikely]] {
+		dump_backtrace();
+	}
+	return backend;
+}
+
+inline bool NamedLogger::log(LogLevel level, std::string_view message) {
+	if (!enabled(level)) {
+		keep_for_backtrace(level, message);
+		return false;
+	}
+	Sample sample;
+	CCLogger* backend = admit(level, sample);
+	if (backend == nullptr) {
+		return false;
+	}
+	backend->push_sampled(message, sample, level, id);
+	return true;
+}
+
+template <TextMaker F>
+bool NamedLogger::log(LogLevel level, F&& maker) {
+	if (!enabled(level)) {
+		if (backtrace.load(std::memory_order_relaxed) != nullptr) {
+			keep_for_backtrace(level, std::string(std::invoke(maker)));
+		}
+		return false;
+	}
+	Sample sample;
+	CCLogger* backend = admit(level, sample);
+	if (backend == nullptr) {
+		return false;
+	}
+	backend->push_sampled(std::string(std::invoke(maker)), sample, level, id);
+	return true;
+}
+
+template <typename F>
+bool NamedLogger::log(LogLevel level, OnWorker<F> deferred) {
+	if (!enabled(level)) {
+		return log(level, deferred.maker);
+	}
+	Sample sample;
+	CCLogger* backend = admit(level, sample);
+	if (backend == nullptr) {
+		return false;
+	}
+	backend->push_deferred(std::move(deferred.maker), level, id, sample);
+	return true;
+}
+
+/**
+ * @brief Logs std::format(fmt, args...) through a NamedLogger, formatting
+ *        (and evaluating the arguments) only if the message is logged.
+ *
+ * @code
+ * CCLOGGER_DEBUG(http, "request {} headers {}", id, dump(headers));
+ * @endcode
+ * The arguments are evaluated on the calling thread, inside the level check.
+ */
+#define CCLOGGER_LOG(logger, level, ...) ((logger).log((level), [&]() { return std::format(__VA_ARGS__); }))
+#define CCLOGGER_TRACE(logger, ...) CCLOGGER_LOG(logger, LogLevel::TRACE, __VA_ARGS__) ///< CCLOGGER_LOG() at TRACE.
+#define CCLOGGER_DEBUG(logger, ...) CCLOGGER_LOG(logger, LogLevel::DEBUG, __VA_ARGS__) ///< CCLOGGER_LOG() at DEBUG.
+#define CCLOGGER_INFO(logger, ...) CCLOGGER_LOG(logger, LogLevel::INFO, __VA_ARGS__) ///< CCLOGGER_LOG() at INFO.
+#define CCLOGGER_WARN(logger, ...) CCLOGGER_LOG(logger, LogLevel::WARN, __VA_ARGS__) ///< CCLOGGER_LOG() at WARN.
+#define CCLOGGER_ERROR(logger, ...) CCLOGGER_LOG(logger, LogLevel::ERROR, __VA_ARGS__) ///< CCLOGGER_LOG() at ERROR.
+#define CCLOGGER_FATAL(logger, ...) CCLOGGER_LOG(logger, LogLevel::FATAL, __VA_ARGS__) ///< CCLOGGER_LOG() at FATAL.
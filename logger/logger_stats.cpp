@@ -0,0 +1,44 @@
+#include "logger_stats.h"
+
+uint64_t HistogramSnapshot::percentile_ns(double p) const {
+	if (count == 0) {
+		return 0;
+	}
+	const uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count - 1)) + 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < kBuckets; ++i) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return i == 0 ? 0 : std::min(max_ns, (uint64_t { 1 } << i) - 1);
+		}
+	}
+	return max_ns;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+	HistogramSnapshot result;
+	for (size_t i = 0; i < HistogramSnapshot::kBuckets; ++i) {
+		result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+	}
+	result.count = count.load(std::memory_order_relaxed);
+	result.total_ns = total_ns.load(std::memory_order_relaxed);
+	result.max_ns = max_ns.load(std::memory_order_relaxed);
+	return result;
+}
+
+LoggerStats LoggerCounters::snapshot(size_t queue_depth) const {
+	LoggerStats result;
+	result.enqueued = enqueued.load(std::memory_order_relaxed);
+	result.enqueued_bytes = enqueued_bytes.load(std::memory_order_relaxed);
+	result.queue_depth = queue_depth;
+	result.batches = batches.load(std::memory_order_relaxed);
+	result.batch_records = batch_records.load(std::memory_order_relaxed);
+	result.max_batch = max_batch.load(std::memory_order_relaxed);
+	result.written_bytes = written_bytes.load(std::memory_order_relaxed);
+	result.suppressed = suppressed.load(std::memory_order_relaxed);
+	result.collapsed = collapsed.load(std::memory_order_relaxed);
+	result.format_ns = format_ns.snapshot();
+	result.write_ns = write_ns.snapshot();
+	result.fsync_ns = fsync_ns.snapshot();
+	return result;
+}
\ No newline at end of file
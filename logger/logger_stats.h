@@ -0,0 +1,173 @@
+/**
+ * @file logger_stats.h
+ * @brief Self-instrumentation counters of CCLogger and the snapshot handed out by CCLogger::stats().
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Plain copy of a LatencyHistogram, safe to keep and export.
+ *
+ * Bucket i counts samples in [2^(i-1), 2^i) nanoseconds, bucket 0 counts zeros.
+ */
+struct HistogramSnapshot {
+	static constexpr size_t kBuckets = 40; ///< Covers up to ~9 minutes per sample.
+
+	std::array<uint64_t, kBuckets> buckets {}; ///< Sample count per power of two bucket.
+	uint64_t count { 0 }; ///< Number of samples.
+	uint64_t total_ns { 0 }; ///< Sum of all samples.
+	uint64_t max_ns { 0 }; ///< Largest sample.
+
+	/**
+	 * @brief Average sample, 0 if there are none.
+	 */
+	double mean_ns() const { return count ? static_cast<double>(total_ns) / count : 0.0; }
+
+	/**
+	 * @brief Upper bound of the bucket holding the p-th quantile.
+	 * @param p Quantile in [0, 1].
+	 */
+	uint64_t percentile_ns(double p) const;
+};
+
+/**
+ * @brief Power of two latency histogram with a single writer and any number of readers.
+ *
+ * Only the worker thread records, so updates are relaxed load/store pairs
+ * instead of read-modify-write instructions.
+ */
+class LatencyHistogram {
+public:
+	/**
+	 * @brief Records one sample, worker thread only.
+	 * @param ns The sample in nanoseconds.
+	 */
+	CCLOGGER_HOT_INLINE void record(uint64_t ns) noexcept {
+		const size_t bucket = std::min<size_t>(std::bit_width(ns), HistogramSnapshot::kBuckets - 1);
+		bump(buckets[bucket], 1);
+		bump(count, 1);
+		bump(total_ns, ns);
+		if (ns > max_ns.load(std::memory_order_relaxed)) {
+			max_ns.store(ns, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Copies the current state, may be torn across fields but never within one.
+	 */
+	HistogramSnapshot snapshot() const;
+
+private:
+	CCLOGGER_HOT_INLINE static void bump(std::atomic<uint64_t>& counter, uint64_t by) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, HistogramSnapshot::kBuckets> buckets {};
+	std::atomic<uint64_t> count { 0 };
+	std::atomic<uint64_t> total_ns { 0 };
+	std::atomic<uint64_t> max_ns { 0 };
+};
+
+/**
+ * @brief Point in time view of a logger's counters, returned by CCLogger::stats().
+ */
+struct LoggerStats {
+	uint64_t enqueued { 0 }; ///< Messages accepted by push_message.
+	uint64_t enqueued_bytes { 0 }; ///< Raw payload bytes accepted by push_message.
+	uint64_t queue_depth { 0 }; ///< Messages waiting in the queue right now.
+	uint64_t batches { 0 }; ///< Non-empty batches drained by the worker.
+	uint64_t batch_records { 0 }; ///< Messages drained over all batches.
+	uint64_t max_batch { 0 }; ///< Largest single batch.
+	uint64_t written_bytes { 0 }; ///< Formatted bytes handed to the IO.
+	uint64_t suppressed { 0 }; ///< Messages refused by push_limited(), counted when the site next logs.
+	uint64_t collapsed { 0 }; ///< Consecutive repeats folded into "last message repeated N times".
+	HistogramSnapshot format_ns; ///< Time spent formatting one message.
+	HistogramSnapshot write_ns; ///< Time spent in AbstractIO::write_logger for one message.
+	HistogramSnapshot fsync_ns; ///< Time spent in AbstractIO::force_flush, one sample per flush.
+
+	/**
+	 * @brief Average drained batch size, 0 before the first batch.
+	 */
+	double avg_batch() const { return batches ? static_cast<double>(batch_records) / batches : 0.0; }
+};
+
+/**
+ * @brief Live counters owned by a CCLogger.
+ *
+ * Producer and worker counters sit on separate cache lines so the worker's
+ * bookkeeping never bounces the line producers are incrementing.
+ */
+class LoggerCounters {
+public:
+	DISABLE_COPY_MOVE(LoggerCounters);
+	LoggerCounters() = default;
+
+	/**
+	 * @brief Producer side: one message of the given size was enqueued.
+	 */
+	CCLOGGER_HOT_INLINE void on_enqueue(size_t bytes) noexcept {
+		enqueued.fetch_add(1, std::memory_order_relaxed);
+		enqueued_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Worker side: a batch of the given size was drained.
+	 */
+	void on_batch(size_t records) noexcept {
+		if (records == 0) {
+			return;
+		}
+		bump(batches, 1);
+		bump(batch_records, records);
+		if (records > max_batch.load(std::memory_order_relaxed)) {
+			max_batch.store(records, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Worker side: formatted bytes went out to the IO.
+	 */
+	void on_write(size_t bytes) noexcept { bump(written_bytes, bytes); }
+
+	/**
+	 * @brief Producer side: a call site reports how many messages it suppressed.
+	 */
+	void on_suppressed(uint64_t count) noexcept { suppressed.fetch_add(count, std::memory_order_relaxed); }
+
+	/**
+	 * @brief Worker side: one message was folded into the pending repeat summary.
+	 */
+	void on_collapsed() noexcept { bump(collapsed, 1); }
+
+	/**
+	 * @brief Copies every counter into a LoggerStats.
+	 * @param queue_depth The current queue size, owned by the caller.
+	 */
+	LoggerStats snapshot(size_t queue_depth) const;
+
+	LatencyHistogram format_ns; ///< Formatting time per message.
+	LatencyHistogram write_ns; ///< IO write time per message.
+	LatencyHistogram fsync_ns; ///< IO flush time per flush.
+
+private:
+	CCLOGGER_HOT_INLINE static void bump(std::atomic<uint64_t>& counter, uint64_t by) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	}
+
+	alignas(64) std::atomic<uint64_t> enqueued { 0 };
+	std::atomic<uint64_t> enqueued_bytes { 0 };
+	std::atomic<uint64_t> suppressed { 0 };
+	alignas(64) std::atomic<uint64_t> batches { 0 };
+	std::atomic<uint64_t> batch_records { 0 };
+	std::atomic<uint64_t> max_batch { 0 };
+	std::atomic<uint64_t> written_bytes { 0 };
+	std::atomic<uint64_t> collapsed { 0 };
+};
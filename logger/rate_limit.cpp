@@ -0,0 +1,88 @@
+#include "rate_limit.h"
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+struct SiteKey {
+	std::string_view file;
+	uint32_t line;
+	uint32_t column;
+
+	bool operator==(const SiteKey&) const = default;
+};
+
+struct SiteKeyHash {
+	size_t operator()(const SiteKey& key) const noexcept {
+		return std::hash<std::string_view> {}(key.file) ^ (size_t { key.line } << 16) ^ key.column;
+	}
+};
+
+struct SiteRegistry {
+	std::mutex locker;
+	std::unordered_map<SiteKey, std::unique_ptr<CallSiteLimiter>, SiteKeyHash> sites;
+};
+
+/* leaked on purpose: threads may still log while static destructors run */
+SiteRegistry& registry() {
+	static SiteRegistry* instance = new SiteRegistry;
+	return *instance;
+}
+
+}
+
+CallSiteLimiter::CallSiteLimiter(const RateLimit& limit)
+    : limit(limit)
+    , interval_ns(limit.rate > 0.0 ? static_cast<uint64_t>(std::llround(1e9 / limit.rate)) : UINT64_MAX / 4)
+    , tolerance_ns((limit.burst - 1) * interval_ns) { }
+
+CallSiteLimiter& CallSiteLimiter::lookup(const std::source_location& loc, const RateLimit& limit) {
+	auto& all = registry();
+	std::lock_guard<std::mutex> lock(all.locker);
+	auto& site = all.sites[SiteKey { loc.file_name(), loc.line(), loc.column() }];
+	if (!site) {
+		site = std::make_unique<CallSiteLimiter>(limit);
+	}
+	return *site;
+}
+
+bool CallSiteLimiter::allow_in_window() noexcept {
+	const uint64_t second = coarse_ns() / 1000000000ull;
+	uint64_t current = state.load(std::memory_order_relaxed);
+	while (true) {
+		if ((current >> 32) != (second & 0xffffffffu)) {
+			if (limit.n == 0) {
+				return false;
+			}
+			if (state.compare_exchange_weak(current, (second << 32) | 1, std::memory_order_relaxed)) {
+				return true;
+			}
+			continue;
+		}
+		/* the window is used up: refuse without writing the shared line */
+		if ((current & 0xffffffffu) >= limit.n) {
+			return false;
+		}
+		if (state.compare_exchange_weak(current, current + 1, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+}
+
+bool CallSiteLimiter::allow_token() noexcept {
+	const uint64_t now = coarse_ns();
+	uint64_t arrival = state.load(std::memory_order_relaxed);
+	while (true) {
+		const uint64_t start = std::max(arrival, now);
+		if (start - now > tolerance_ns) {
+			return false;
+		}
+		if (state.compare_exchange_weak(arrival, start + interval_ns, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+}
\ No newline at end of file
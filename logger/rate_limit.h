@@ -0,0 +1,149 @@
+/**
+ * @file rate_limit.h
+ * @brief Per call site rate limiting of log messages, see CCLogger::push_limited().
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <source_location>
+
+/**
+ * @enum RateLimitKind
+ * @brief How a call site decides which messages to let through.
+ */
+enum class RateLimitKind : uint8_t {
+	EveryN, ///< The 1st, (n+1)th, (2n+1)th... message.
+	FirstNPerSecond, ///< The first n messages of every second.
+	TokenBucket ///< rate messages per second on average, bursts of up to burst.
+};
+
+/**
+ * @brief A rate limit, attached to a call site the first time the site logs.
+ */
+struct RateLimit {
+	RateLimitKind kind { RateLimitKind::EveryN }; ///< The policy.
+	uint32_t n { 1 }; ///< EveryN and FirstNPerSecond: the N.
+	double rate { 1.0 }; ///< TokenBucket: tokens refilled per second.
+	uint32_t burst { 1 }; ///< TokenBucket: bucket size.
+
+	static constexpr RateLimit every_n(uint32_t n) { return { RateLimitKind::EveryN, std::max<uint32_t>(n, 1) }; }
+	static constexpr RateLimit first_n_per_second(uint32_t n) { return { RateLimitKind::FirstNPerSecond, n }; }
+	static constexpr RateLimit token_bucket(double rate, uint32_t burst) {
+		return { RateLimitKind::TokenBucket, 1, rate, std::max<uint32_t>(burst, 1) };
+	}
+};
+
+/**
+ * @brief Limiter state of one call site, shared by all threads logging from it.
+ *
+ * allow() is a single atomic operation on the site's own cache line; a
+ * suppressed message additionally bumps the suppressed counter and is
+ * otherwise never built, copied or enqueued. The time based policies read
+ * CLOCK_MONOTONIC_COARSE, so their granularity is the kernel tick (a few ms).
+ */
+class CallSiteLimiter {
+public:
+	DISABLE_COPY_MOVE(CallSiteLimiter);
+
+	/**
+	 * @brief Creates a limiter, normally obtained through at() instead.
+	 * @param limit The policy of this site.
+	 */
+	explicit CallSiteLimiter(const RateLimit& limit);
+
+	/**
+	 * @brief Finds (or creates on first use) the limiter of a call site.
+	 *
+	 * The limit is bound when the site is first seen and ignored afterwards.
+	 * Lookups hit a small per thread cache, the global registry is only
+	 * consulted the first time a thread logs from a site.
+	 * @param loc The call site.
+	 * @param limit The policy to attach if the site is new.
+	 */
+	static CCLOGGER_HOT_INLINE CallSiteLimiter& at(const std::source_location& loc, const RateLimit& limit) {
+		struct CacheSlot {
+			const char* file { nullptr };
+			uint32_t line { 0 };
+			uint32_t column { 0 };
+			CallSiteLimiter* site { nullptr };
+		};
+		static thread_local std::array<CacheSlot, kCacheSlots> cache {};
+
+		const auto key = reinterpret_cast<uintptr_t>(loc.file_name()) ^ (uintptr_t { loc.line() } * 0x9e3779b1u) ^ loc.column();
+		CacheSlot& slot = cache[key % kCacheSlots];
+		const bool hit = slot.site && slot.file == loc.file_name() && slot.line == loc.line() && slot.column == loc.column();
+		if (!hit) [[unlikely]] {
+			slot = { loc.file_name(), loc.line(), loc.column(), &lookup(loc, limit) };
+		}
+		return *slot.site;
+	}
+
+	/**
+	 * @brief Decides whether the current message of this site goes through.
+	 */
+	CCLOGGER_HOT_INLINE bool allow() noexcept {
+		bool passed;
+		switch (limit.kind) {
+		case RateLimitKind::EveryN:
+			passed = state.fetch_add(1, std::memory_order_relaxed) % limit.n == 0;
+			break;
+		case RateLimitKind::FirstNPerSecond:
+			passed = allow_in_window();
+			break;
+		case RateLimitKind::TokenBucket:
+		default:
+			passed = allow_token();
+			break;
+		}
+		if (!passed) {
+			suppressed.fetch_add(1, std::memory_order_relaxed);
+		}
+		return passed;
+	}
+
+	/**
+	 * @brief Returns and resets the number of messages suppressed since the last call.
+	 */
+	uint64_t take_suppressed() noexcept {
+		return suppressed.load(std::memory_order_relaxed) ? suppressed.exchange(0, std::memory_order_relaxed) : 0;
+	}
+
+	/**
+	 * @brief The policy bound to this site.
+	 */
+	const RateLimit& get_limit() const noexcept { return limit; }
+
+	static constexpr size_t kCacheSlots = 64; ///< Per thread call site cache entries.
+
+private:
+	static CallSiteLimiter& lookup(const std::source_location& loc, const RateLimit& limit);
+
+	static CCLOGGER_HOT_INLINE uint64_t coarse_ns() noexcept {
+		timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+	}
+
+	/**
+	 * @brief FirstNPerSecond: state packs the current second (high half) and its count (low half).
+	 */
+	bool allow_in_window() noexcept;
+
+	/**
+	 * @brief TokenBucket as GCRA: state is the theoretical arrival time of the next message.
+	 */
+	bool allow_token() noexcept;
+
+	const RateLimit limit; ///< The policy.
+	const uint64_t interval_ns; ///< TokenBucket: nanoseconds per token.
+	const uint64_t tolerance_ns; ///< TokenBucket: how far ahead of now the arrival time may run.
+	alignas(64) std::atomic<uint64_t> state { 0 }; ///< Policy specific, see above.
+	std::atomic<uint64_t> suppressed { 0 }; ///< Messages refused since the last take_suppressed().
+};
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include "sampling.h"
+#include <chrono>
+#include <cstdint>
+
+uint64_t Sampler::seed() noexcept {
+	/* distinct per thread even when two threads start in the same tick */
+	static std::atomic<uint64_t> threads { 0 };
+	const auto now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	return now ^ (threads.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ull)
+	     ^ reinterpret_cast<uintptr_t>(&random_state);
+}
@@ -0,0 +1,164 @@
+/**
+ * @file sampling.h
+ * @brief Probabilistic sampling of log messages per level or per call site, decided before the message is built.
+ */
+
+#pragma once
+
+#include "core/logger_tools.h"
+#include "tools/class_helper.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Outcome of a sampling draw.
+ *
+ * False when the message should be skipped; otherwise carries the rate it
+ * was kept with, to be recorded in the line (CCLogger::push_sampled()) so
+ * downstream tooling can reweight counts by 1 / rate.
+ */
+struct Sample {
+	float rate { 1.0f }; ///< Probability the message was kept with, 0 when skipped.
+
+	explicit operator bool() const noexcept { return rate > 0.0f; } ///< Whether to log the message.
+};
+
+/**
+ * @brief Sampling rates per level, plus the thread local generator every draw uses.
+ *
+ * A rate is stored as a 32 bit fixed point threshold in one atomic, so
+ * set_rate() is lock free and takes effect on the next draw. A draw costs
+ * one relaxed load, and a few multiplications of the thread's own
+ * splitmix64 state when the rate is below 1. All levels start at rate 1,
+ * i.e. sampling is off.
+ *
+ * @code
+ * Sampler::set_rate(LogLevel::TRACE, 0.01);
+ * if (const Sample sample = Sampler::draw(LogLevel::TRACE)) {
+ *     logger.push_sampled(build_expensive_message(), sample);
+ * }
+ * @endcode
+ */
+class Sampler {
+public:
+	DISABLE_COPY_MOVE(Sampler);
+	Sampler() = delete;
+
+	static constexpr uint64_t kAlways = uint64_t { 1 } << 32; ///< Threshold of rate 1.
+
+	/**
+	 * @brief Sets the rate of a level, lock free.
+	 *
+	 * @param level The level.
+	 * @param rate Probability of keeping a message, clamped to [0, 1].
+	 */
+	static void set_rate(LogLevel level, double rate) noexcept {
+		thresholds[Weight(level) % kLogLevelCount].store(to_threshold(rate), std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief The rate of a level.
+	 */
+	static double rate(LogLevel level) noexcept {
+		return to_rate(thresholds[Weight(level) % kLogLevelCount].load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * @brief Decides whether to log a message of this level.
+	 */
+	static CCLOGGER_HOT_INLINE Sample draw(LogLevel level) noexcept {
+		return draw_threshold(thresholds[Weight(level) % kLogLevelCount].load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * @brief Decides with a fixed point threshold, see to_threshold().
+	 */
+	static CCLOGGER_HOT_INLINE Sample draw_threshold(uint64_t threshold) noexcept {
+		if (threshold >= kAlways) {
+			return {};
+		}
+		return { (next_random() >> 32) < threshold ? static_cast<float>(to_rate(threshold)) : 0.0f };
+	}
+
+	/**
+	 * @brief Next number of the calling thread's generator (splitmix64).
+	 */
+	static CCLOGGER_HOT_INLINE uint64_t next_random() noexcept {
+		uint64_t z = (random_state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	/**
+	 * @brief Converts a rate to the fixed point threshold draws compare against.
+	 */
+	static constexpr uint64_t to_threshold(double rate) noexcept {
+		if (!(rate > 0.0)) {
+			return 0;
+		}
+		return rate >= 1.0 ? kAlways : static_cast<uint64_t>(rate * static_cast<double>(kAlways));
+	}
+
+	/**
+	 * @brief Converts a threshold back to a rate.
+	 */
+	static constexpr double to_rate(uint64_t threshold) noexcept {
+		return static_cast<double>(threshold) / static_cast<double>(kAlways);
+	}
+
+private:
+	/**
+	 * @brief Seed of a thread's generator, different per thread and per run.
+	 */
+	static uint64_t seed() noexcept;
+
+	static inline std::array<std::atomic<uint64_t>, kLogLevelCount> thresholds { kAlways, kAlways, kAlways, kAlways,
+		                                                                         kAlways, kAlways, kAlways };
+	static inline thread_local uint64_t random_state = seed();
+};
+
+/**
+ * @brief Sampling rate of one call site, owned by the site.
+ *
+ * Declare it static next to the hot log statement; its rate can be
+ * changed from any thread without locks.
+ *
+ * @code
+ * static SampledSite site { 0.1 };
+ * if (const Sample sample = site.draw()) {
+ *     logger.push_sampled(std::format("cache miss {}", key), sample);
+ * }
+ * @endcode
+ */
+class SampledSite {
+public:
+	DISABLE_COPY_MOVE(SampledSite);
+
+	/**
+	 * @param rate Probability of keeping a message, clamped to [0, 1].
+	 */
+	explicit SampledSite(double rate) noexcept
+	    : threshold(Sampler::to_threshold(rate)) { }
+
+	/**
+	 * @brief Changes the rate, lock free.
+	 */
+	void set_rate(double rate) noexcept { threshold.store(Sampler::to_threshold(rate), std::memory_order_relaxed); }
+
+	/**
+	 * @brief The current rate.
+	 */
+	double rate() const noexcept { return Sampler::to_rate(threshold.load(std::memory_order_relaxed)); }
+
+	/**
+	 * @brief Decides whether to log this time.
+	 */
+	CCLOGGER_HOT_INLINE Sample draw() const noexcept {
+		return Sampler::draw_threshold(threshold.load(std::memory_order_relaxed));
+	}
+
+private:
+	std::atomic<uint64_t> threshold; ///< Fixed point rate, see Sampler::to_threshold().
+};
@@ -0,0 +1,26 @@
+#include "shm_logger.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+uint32_t current_tid() noexcept {
+	thread_local const uint32_t tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+	return tid;
+}
+
+}
+
+ShmLogger::ShmLogger(const std::string& name, size_t capacity)
+    : ring(ShmRing::attach(name, capacity))
+    , pid(static_cast<uint32_t>(::getpid())) { }
+
+bool ShmLogger::push_message(std::string_view raw) {
+	const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	    std::chrono::system_clock::now().time_since_epoch());
+	return ring->try_write(raw, pid, current_tid(), static_cast<uint64_t>(now.count()));
+}
+
+bool ShmLogger::sync_flush(std::chrono::milliseconds timeout) {
+	return ring->wait_consumed(ring->write_position(), timeout);
+}
\ No newline at end of file
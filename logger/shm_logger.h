@@ -0,0 +1,67 @@
+/**
+ * @file shm_logger.h
+ * @brief Defines ShmLogger, a producer front end that hands records to an out-of-process cclogger-agent.
+ */
+
+#pragma once
+
+#include "cached_queue/shm_ring.h"
+#include "tools/class_helper.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Logger without a worker thread: push_message() writes straight into a ShmRing.
+ *
+ * Formatting, file IO and fsync all happen in the cclogger-agent process
+ * draining the ring, so the only cost left in this process is stamping the
+ * record and one memcpy into shared memory. Records already pushed survive
+ * this process crashing.
+ */
+class ShmLogger {
+public:
+	DISABLE_COPY_MOVE(ShmLogger);
+	ShmLogger() = delete;
+
+	/**
+	 * @brief Attaches to (or creates) the ring the agent drains.
+	 *
+	 * @param name The shm_open() name shared with the agent, e.g. "/myapp-log".
+	 * @param capacity Ring size if this side creates it.
+	 * @throw std::system_error, std::runtime_error See ShmRing::attach().
+	 */
+	explicit ShmLogger(const std::string& name, size_t capacity = ShmRing::kDefaultCapacity);
+
+	/**
+	 * @brief Writes a message into the ring, stamped with this thread and the current time.
+	 *
+	 * @param raw The log message.
+	 * @return false if the ring is full and the message was dropped.
+	 */
+	bool push_message(std::string_view raw);
+
+	/**
+	 * @brief Waits until the agent took everything pushed so far.
+	 *
+	 * @param timeout Gives up after this long, e.g. when no agent runs.
+	 * @return Whether the agent caught up in time.
+	 */
+	bool sync_flush(std::chrono::milliseconds timeout = std::chrono::seconds(1));
+
+	/**
+	 * @brief Messages dropped because the ring was full, by any writer of the ring.
+	 */
+	uint64_t dropped() const { return ring->dropped(); }
+
+	/**
+	 * @brief The underlying ring.
+	 */
+	ShmRing& get_ring() { return *ring; }
+
+private:
+	std::unique_ptr<ShmRing> ring; ///< The shared ring.
+	uint32_t pid; ///< This process, taken once at construction.
+};
\ No newline at end of file
@@ -0,0 +1,50 @@
+/**
+ * @file wait_policy.h
+ * @brief Defines how the CCLogger worker thread waits for new log records.
+ */
+
+#pragma once
+
+#include "tools/class_helper.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+/**
+ * @enum WaitStrategy
+ * @brief Selects how the worker thread idles while the queue is empty.
+ */
+enum class WaitStrategy : uint8_t {
+	Blocking, ///< Park on the condition variable until a record arrives (default).
+	BusySpin, ///< Never park, poll the queue continuously. Burns one core.
+	SpinYield, ///< Spin, then yield the CPU, then park as Blocking does.
+	TimedBatch ///< Wake at most every batch_interval, or once batch_threshold records are pending.
+};
+
+/**
+ * @brief Tuning knobs for the worker wait strategy.
+ *
+ * Producers only pay for a wakeup (mutex + futex) when the worker is actually
+ * parked, and with TimedBatch only once enough records have piled up.
+ */
+struct WaitPolicy {
+	WaitStrategy strategy { WaitStrategy::Blocking }; ///< The strategy in use.
+	uint32_t spin_rounds { 4096 }; ///< SpinYield: polls before starting to yield.
+	uint32_t yield_rounds { 64 }; ///< SpinYield: yields before parking.
+	std::chrono::microseconds batch_interval { 500 }; ///< TimedBatch: longest delay of a pending record.
+	size_t batch_threshold { 256 }; ///< TimedBatch: pending records that wake the worker early.
+};
+
+/**
+ * @brief Hints the CPU that we are inside a spin-wait loop.
+ */
+CCLOGGER_HOT_INLINE void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield" ::: "memory");
+#else
+	std::this_thread::yield();
+#endif
+}
@@ -1,36 +1,18 @@
+#include "core/log_clock.h"
 #include "core/logger_tools.h"
+#include "core/thread_registry.h"
 #include "format/logger_format.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <chrono>
 #include <memory>
+#include <thread>
+#include <stdexcept>
 
 struct MockTools : public AbsLoggerTools {
 	std::string current_time() override { return "MOCK_TIME"; }
 	std::string thread_id() override { return "MOCK_THREAD_ID"; }
-	constexpr const std::string& toString(LogLevel level) override {
-		static const std::unordered_map<LogLevel, std::string> kLevelNames = {
-			{ LogLevel::TRACE, "TRACE" },
-			{ LogLevel::DEBUG, "DEBUG" },
-			{ LogLevel::INFO, "INFO" },
-			{ LogLevel::WARN, "WARN" },
-			{ LogLevel::ERROR, "ERROR" },
-			{ LogLevel::FATAL, "FATAL" },
-			{ LogLevel::OFF, "OFF" }
-		};
-		return kLevelNames.at(level);
-	}
-
-	constexpr LogLevel fromString(const std::string& str) override {
-		static const std::unordered_map<std::string, LogLevel> kLevelMap = {
-			{ "trace", LogLevel::TRACE }, { "debug", LogLevel::DEBUG }, { "info", LogLevel::INFO }, { "warn", LogLevel::WARN }, { "error", LogLevel::ERROR }, { "fatal", LogLevel::FATAL }, { "off", LogLevel::OFF }
-		};
-
-		std::string lower;
-		std::transform(str.begin(), str.end(), std::back_inserter(lower),
-		               [](char c) { return std::tolower(c); });
-
-		return kLevelMap.at(lower);
-	}
 };
 
 int main() {
@@ -70,6 +52,94 @@ int main() {
 	assert(log.find("INFO") != std::string::npos);
 	assert(log.find("Hello, test!") != std::string::npos);
 
+	// 等级名称表与解析
+	assert(AbsLoggerTools::toString(LogLevel::FATAL) == "FATAL");
+	assert(AbsLoggerTools::toPaddedString(LogLevel::INFO) == "INFO ");
+	assert(AbsLoggerTools::fromString("wArN") == LogLevel::WARN);
+	assert(!AbsLoggerTools::tryFromString("warning"));
+	bool thrown = false;
+	try {
+		AbsLoggerTools::fromString("");
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	// 打开等级对齐
+	factory.set_enable_levelPadding(true);
+	log = factory.format(msg);
+	assert(log.find("[INFO ]") != std::string::npos);
+
+	// 线程注册表：每个线程一个编号，ID 字符串只生成一次
+	const uint32_t self = ThreadRegistry::current_index();
+	assert(ThreadRegistry::current_index() == self);
+	uint32_t other = self;
+	std::thread([&other]() {
+		other = ThreadRegistry::current_index();
+		ThreadRegistry::set_current_name("producer-1");
+	}).join();
+	assert(other != self);
+	assert(ThreadRegistry::label(other) == "producer-1");
+	assert(ThreadRegistry::label(self).starts_with("0x"));
+	assert(ThreadRegistry::label(self).data() == ThreadRegistry::label(self).data());
+
+	// 记录里的线程由 worker 解析为生产者线程的名字
+	DefLoggerFormatFactory record_factory;
+	record_factory.set_enable_time(false);
+	log = record_factory.format(LogRecord { .message = "from record", .thread_index = other });
+	assert(log.find("[th:producer-1]") != std::string::npos);
+	assert(log.find("from record") != std::string::npos);
+	// 记录不带调用位置，不打印格式化器自己的源码位置
+	assert(log.find("logger_format.cpp") == std::string::npos);
+
+	// 线程退出后编号的槽位被复用，代数不同：旧记录仍解析为原线程，不会显示成新线程
+	uint32_t first = 0;
+	std::thread([&first]() {
+		first = ThreadRegistry::current_index();
+		ThreadRegistry::set_current_name("first");
+	}).join();
+	uint32_t reuser = ThreadRegistry::kExhausted;
+	for (int i = 0; i < 16 && (reuser & ThreadRegistry::kSlotMask) != (first & ThreadRegistry::kSlotMask); ++i) {
+		std::thread([&reuser]() { reuser = ThreadRegistry::current_index(); }).join();
+	}
+	assert((reuser & ThreadRegistry::kSlotMask) == (first & ThreadRegistry::kSlotMask) && reuser != first
+	       && "退出线程的槽位没有被复用！");
+	assert(ThreadRegistry::label(first) == "first" && ThreadRegistry::label(reuser) != "first");
+	// 按任务创建线程，槽位数量不随线程总数增长；过旧的记录显示 "?"
+	uint32_t highest = 0;
+	for (int i = 0; i < 5000; ++i) {
+		std::thread([&highest]() {
+			highest = std::max(highest, ThreadRegistry::current_index() & ThreadRegistry::kSlotMask);
+		}).join();
+	}
+	assert(highest < 16 && "线程编号没有复用！");
+	assert(ThreadRegistry::label(first) == "?" && ThreadRegistry::label(ThreadRegistry::kExhausted) == "?");
+
+	// 自定义工具的线程与时间也用于记录
+	factory.set_enable_time(true);
+	factory.set_enable_threadid(true);
+	log = factory.format(LogRecord { .message = "custom tools", .thread_index = other });
+	assert(log.find("[MOCK_TIME]") != std::string::npos && log.find("[th:MOCK_THREAD_ID]") != std::string::npos);
+
+	// 时钟源：生产者只取原始 tick，格式化时才转换为日历时间
+	for (auto wanted : { ClockSource::System, ClockSource::MonotonicCoarse, ClockSource::Tsc }) {
+		const ClockSource used = LogClock::set_source(wanted);
+		assert(used == wanted || (wanted == ClockSource::Tsc && used == ClockSource::System));
+		const auto stamp = LogClock::now();
+		assert(stamp.source == used);
+		const auto drift = std::chrono::system_clock::now() - LogClock::to_system(stamp);
+		assert(std::chrono::abs(drift) < std::chrono::milliseconds(50) && "时钟转换偏差过大！");
+		std::cout << "clock " << static_cast<int>(used) << " drift "
+		          << std::chrono::duration_cast<std::chrono::microseconds>(drift).count() << " us\n";
+	}
+	LogClock::set_source(ClockSource::System);
+
+	// 时间格式：YYYY-mm-dd HH:MM:SS.nnnnnnnnn
+	LoggerTools real_tools;
+	const auto when = std::chrono::sys_days(std::chrono::year(2025) / 5 / 29) + std::chrono::hours(8) + std::chrono::nanoseconds(1234);
+	assert(real_tools.format_time(when) == "2025-05-29 08:00:00.000001234");
+	assert(real_tools.format_time(when + std::chrono::seconds(1)) == "2025-05-29 08:00:01.000001234");
+
 	std::cout << "All tests passed!" << std::endl;
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "IO/consoleio.h"
+#include "IO/socketio.h"
+#include "logger/logger.h"
+#include <arpa/inet.h>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int bind_unix(const std::string& path, int type) {
+	::unlink(path.c_str());
+	const int fd = ::socket(AF_UNIX, type, 0);
+	assert(fd != -1);
+	sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	const int bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	assert(bound == 0);
+	return fd;
+}
+
+/**
+ * @brief Reads whatever arrives until the socket stays quiet for 200 ms.
+ */
+std::vector<std::string> receive_all(int fd) {
+	std::vector<std::string> chunks;
+	std::vector<char> buffer(1 << 16);
+	while (true) {
+		pollfd waiter { fd, POLLIN, 0 };
+		if (::poll(&waiter, 1, 200) <= 0) {
+			break;
+		}
+		const ssize_t size = ::recv(fd, buffer.data(), buffer.size(), 0);
+		if (size <= 0) {
+			break;
+		}
+		chunks.emplace_back(buffer.data(), static_cast<size_t>(size));
+	}
+	return chunks;
+}
+
+std::vector<std::string> split_lines(const std::vector<std::string>& chunks) {
+	std::string all;
+	for (const auto& chunk : chunks) {
+		all += chunk;
+	}
+	std::vector<std::string> lines;
+	size_t start = 0;
+	for (size_t end; (end = all.find('\n', start)) != std::string::npos; start = end + 1) {
+		lines.push_back(all.substr(start, end - start));
+	}
+	return lines;
+}
+
+void check_sequence(const std::vector<std::string>& lines, int count) {
+	assert(lines.size() == static_cast<size_t>(count) && "套接字日志行数错误！");
+	for (int i = 0; i < count; ++i) {
+		assert(lines[i] == "socket " + std::to_string(i) && "套接字日志顺序错误！");
+	}
+}
+
+}
+
+void unix_datagram_test() {
+	std::cout << "==== Unix 数据报套接字测试 ====" << std::endl;
+	const std::string path = "test_io_dgram.sock";
+	const int listener = bind_unix(path, SOCK_DGRAM);
+	constexpr int count = 1000;
+
+	auto io = new SocketIO(SocketEndpoint::unix_datagram(path));
+	{
+		// 收集器与写入同时读取，Unix 数据报套接字只能排队少量数据报
+		auto received = std::async(std::launch::async, receive_all, listener);
+		CCLogger logger(io);
+		for (int i = 0; i < count; ++i) {
+			logger.push_message("socket " + std::to_string(i));
+		}
+		logger.sync_flush();
+		const auto chunks = received.get();
+		check_sequence(split_lines(chunks), count);
+		// 多行打包进一个数据报
+		assert(chunks.size() < static_cast<size_t>(count));
+		std::cout << count << " 行日志打包为 " << chunks.size() << " 个数据报\n\n";
+	}
+	::close(listener);
+	::unlink(path.c_str());
+}
+
+void udp_test() {
+	std::cout << "==== UDP 套接字测试 ====" << std::endl;
+	const int listener = ::socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in address {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	const int bound = ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	assert(bound == 0);
+	socklen_t length = sizeof(address);
+	::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+	constexpr int count = 200;
+
+	SocketOptions options;
+	options.max_datagram = 1400;
+	{
+		auto received = std::async(std::launch::async, receive_all, listener);
+		CCLogger logger(new SocketIO(SocketEndpoint::udp("127.0.0.1", ntohs(address.sin_port)), options));
+		for (int i = 0; i < count; ++i) {
+			logger.push_message("socket " + std::to_string(i));
+		}
+		logger.sync_flush();
+		const auto chunks = received.get();
+		for (const auto& chunk : chunks) {
+			assert(chunk.size() <= options.max_datagram && "数据报超过上限！");
+		}
+		check_sequence(split_lines(chunks), count);
+		std::cout << "UDP 收到 " << count << " 行，共 " << chunks.size() << " 个数据报\n";
+	}
+
+	// 超过 max_datagram 的行被拆分，不会卡住后面的行；无需 sync_flush，批次结束即发送
+	{
+		auto io = new SocketIO(SocketEndpoint::udp("127.0.0.1", ntohs(address.sin_port)), options);
+		CCLogger logger(io);
+		const std::string longline(5000, 'l');
+		logger.push_message(longline);
+		for (int i = 0; i < 10; ++i) {
+			logger.push_message("socket " + std::to_string(i));
+		}
+		const auto chunks = receive_all(listener);
+		for (const auto& chunk : chunks) {
+			assert(chunk.size() <= options.max_datagram && "数据报超过上限！");
+		}
+		auto lines = split_lines(chunks);
+		assert(!lines.empty() && lines.front() == longline && "长行拆分后内容错误！");
+		lines.erase(lines.begin());
+		check_sequence(lines, 10);
+	}
+
+	// 内核拒绝的超大数据报（EMSGSIZE）被丢弃并计数，后面的行照常发送
+	{
+		SocketOptions huge;
+		huge.max_datagram = 100000;
+		auto io = new SocketIO(SocketEndpoint::udp("127.0.0.1", ntohs(address.sin_port)), huge);
+		CCLogger logger(io);
+		logger.push_message(std::string(huge.max_datagram - 1, 'h')); // 加上换行恰好一个数据报，超过 UDP 上限
+		for (int i = 0; i < 10; ++i) {
+			logger.push_message("socket " + std::to_string(i));
+		}
+		logger.sync_flush();
+		check_sequence(split_lines(receive_all(listener)), 10);
+		assert(io->get_oversized_datagrams() == 1 && io->get_pending_bytes() == 0 && "超大数据报阻塞了发送！");
+		std::cout << "超长行：拆分发送，内核拒绝的数据报被丢弃\n\n";
+	}
+	::close(listener);
+}
+
+void unix_stream_test() {
+	std::cout << "==== Unix 流套接字测试 ====" << std::endl;
+	const std::string path = "test_io_stream.sock";
+	const int listener = bind_unix(path, SOCK_STREAM);
+	::listen(listener, 1);
+	constexpr int count = 5000;
+	{
+		// 收集器边接受连接边读取，每批一次发送的小数据很快会占满未读取的套接字缓冲区
+		auto received = std::async(std::launch::async, [listener]() {
+			const int connection = ::accept(listener, nullptr, nullptr);
+			assert(connection != -1);
+			auto chunks = receive_all(connection);
+			::close(connection);
+			return chunks;
+		});
+		CCLogger logger(new SocketIO(SocketEndpoint::unix_stream(path)));
+		for (int i = 0; i < count; ++i) {
+			logger.push_message("socket " + std::to_string(i));
+		}
+		logger.sync_flush();
+		check_sequence(split_lines(received.get()), count);
+		std::cout << "流套接字按序收到 " << count << " 行\n\n";
+	}
+	::close(listener);
+	::unlink(path.c_str());
+}
+
+void syslog_framing_test() {
+	std::cout << "==== syslog 帧格式测试 ====" << std::endl;
+	const std::string path = "test_io_syslog.sock";
+	const int listener = bind_unix(path, SOCK_DGRAM);
+	SocketOptions options;
+	options.syslog_framing = true;
+	options.syslog_tag = "test_io";
+	{
+		CCLogger logger(new SocketIO(SocketEndpoint::unix_datagram(path), options));
+		logger.push_message("hello");
+		logger.push_message("world");
+		logger.sync_flush();
+		const auto chunks = receive_all(listener);
+		// 每条消息单独一个数据报，没有结尾换行
+		const std::string header = "<14>test_io[" + std::to_string(::getpid()) + "]: ";
+		assert(chunks.size() == 2);
+		assert(chunks[0] == header + "hello");
+		assert(chunks[1] == header + "world");
+		std::cout << "syslog 数据报：" << chunks[0] << "\n\n";
+	}
+	::close(listener);
+	::unlink(path.c_str());
+}
+
+void slow_collector_test() {
+	std::cout << "==== 慢速接收端测试 ====" << std::endl;
+	const std::string path = "test_io_slow.sock";
+	// 从不读取的接收端：内核缓冲区很快被填满
+	const int listener = bind_unix(path, SOCK_DGRAM);
+	SocketOptions options;
+	options.max_pending_bytes = 64 * 1024;
+	options.flush_timeout = std::chrono::milliseconds(50);
+	auto io = new SocketIO(SocketEndpoint::unix_datagram(path), options);
+	{
+		CCLogger logger(io);
+		const std::string payload(200, 'x');
+		for (int i = 0; i < 20000; ++i) {
+			logger.push_message(payload);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		logger.sync_flush();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		// 后台线程不会被阻塞，重试缓冲区有上限
+		assert(elapsed < std::chrono::seconds(5) && "慢速接收端阻塞了刷新！");
+		assert(io->get_dropped_bytes() > 0 && "重试缓冲区未丢弃旧数据！");
+		assert(io->get_pending_bytes() <= options.max_pending_bytes + options.max_datagram);
+		std::cout << "刷新耗时 " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+		          << " ms，丢弃 " << io->get_dropped_bytes() << " 字节\n\n";
+	}
+	::close(listener);
+	::unlink(path.c_str());
+}
+
+void absent_collector_test() {
+	std::cout << "==== 接收端缺失测试 ====" << std::endl;
+	const std::string path = "test_io_absent.sock";
+	::unlink(path.c_str());
+	{
+		CCLogger logger(new SocketIO(SocketEndpoint::unix_datagram(path)));
+		for (int i = 0; i < 100; ++i) {
+			logger.push_message("nobody listens");
+		}
+		logger.sync_flush();
+	}
+	std::cout << "没有接收端时写入与析构均正常返回\n\n";
+}
+
+std::string read_pipe(int fd) {
+	std::string data;
+	char buffer[4096];
+	ssize_t size;
+	while ((size = ::read(fd, buffer, sizeof(buffer))) > 0) {
+		data.append(buffer, static_cast<size_t>(size));
+	}
+	return data;
+}
+
+void console_test() {
+	std::cout << "==== 控制台输出测试 ====" << std::endl;
+	int out[2];
+	int err[2];
+	const bool piped = ::pipe2(out, O_NONBLOCK) == 0 && ::pipe2(err, O_NONBLOCK) == 0;
+	assert(piped);
+
+	// 管道不是终端：自动模式不加颜色
+	{
+		ConsoleOptions options;
+		options.stdout_fd = out[1];
+		options.stderr_fd = err[1];
+		FastConsoleIO io(options);
+		assert(!io.get_stdout_colored() && !io.get_stderr_colored());
+		io.write_leveled("[INFO] : a\n", LogLevel::INFO);
+		io.write_leveled("[ERROR] : b\n", LogLevel::ERROR);
+		io.write_logger("plain\n");
+		io.force_flush();
+		assert(read_pipe(out[0]) == "[INFO] : a\nplain\n");
+		assert(read_pipe(err[0]) == "[ERROR] : b\n");
+	}
+
+	// 强制着色，且超过缓冲区的长行整行写出
+	{
+		ConsoleOptions options;
+		options.color = ColorMode::Always;
+		options.stdout_fd = out[1];
+		options.stderr_fd = err[1];
+		options.buffer_size = 64;
+		FastConsoleIO io(options);
+		const std::string longline = "[WARN ] : " + std::string(100, 'w') + "\n";
+		io.write_leveled("[INFO] : a\n", LogLevel::INFO);
+		io.write_leveled(longline, LogLevel::WARN);
+		io.write_leveled("[FATAL] : c\n", LogLevel::FATAL);
+		io.force_flush();
+		const std::string warn(kLevelColors[Weight(LogLevel::WARN)]);
+		assert(read_pipe(out[0])
+		       == std::string(kLevelColors[Weight(LogLevel::INFO)]) + "[INFO] : a" + std::string(kColorReset) + "\n"
+		           + warn + longline.substr(0, longline.size() - 1) + std::string(kColorReset) + "\n");
+		assert(read_pipe(err[0])
+		       == std::string(kLevelColors[Weight(LogLevel::FATAL)]) + "[FATAL] : c" + std::string(kColorReset) + "\n");
+	}
+	// 后台线程每写完一批就把缓冲区交给系统，无需 force_flush
+	{
+		ConsoleOptions options;
+		options.stdout_fd = out[1];
+		options.stderr_fd = err[1];
+		CCLogger logger(new FastConsoleIO(options));
+		logger.set_formattor(new DummyFormatFactory);
+		logger.push_message(std::string("[INFO] : batch"));
+		std::string got;
+		for (int i = 0; i < 500 && got.empty(); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			got = read_pipe(out[0]);
+		}
+		assert(got == "[INFO] : batch\n" && "批次结束后控制台行仍停留在缓冲区！");
+	}
+	// 分流与着色只看记录的等级，不解析消息文本
+	{
+		ConsoleOptions options;
+		options.color = ColorMode::Always;
+		options.stdout_fd = out[1];
+		options.stderr_fd = err[1];
+		CCLogger logger(new FastConsoleIO(options));
+		logger.set_formattor(new DummyFormatFactory);
+		logger.push_message(std::string("[error] retrying"));
+		logger.push_message(std::string("[OFF] quiet"));
+		logger.push_message(std::string_view("disk full"), LogLevel::ERROR);
+		logger.sync_flush();
+		assert(read_pipe(out[0]) == "[error] retrying\n[OFF] quiet\n" && "消息文本中的等级被当作了记录等级！");
+		assert(read_pipe(err[0])
+		       == std::string(kLevelColors[Weight(LogLevel::ERROR)]) + "disk full" + std::string(kColorReset) + "\n");
+	}
+	for (int fd : { out[0], out[1], err[0], err[1] }) {
+		::close(fd);
+	}
+
+	// 终端不缓冲：写入后立即可读
+	const int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+	assert(master != -1 && ::grantpt(master) == 0 && ::unlockpt(master) == 0);
+	const int terminal = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+	assert(terminal != -1);
+	{
+		ConsoleOptions options;
+		options.color = ColorMode::Never;
+		options.stdout_fd = terminal;
+		options.stderr_fd = terminal;
+		FastConsoleIO io(options);
+		io.write_logger("[INFO] : tty\n");
+		pollfd ready { master, POLLIN, 0 };
+		assert(::poll(&ready, 1, 1000) == 1 && "终端输出被缓冲了！");
+		char data[64];
+		const ssize_t n = ::read(master, data, sizeof(data));
+		assert(n > 0 && std::string(data, n).starts_with("[INFO] : tty"));
+	}
+	::close(terminal);
+	::close(master);
+	std::cout << "控制台输出：按级别分流到 stdout/stderr，仅在需要时着色\n\n";
+}
+
+int main() {
+	unix_datagram_test();
+	udp_test();
+	unix_stream_test();
+	syslog_framing_test();
+	slow_collector_test();
+	absent_collector_test();
+	console_test();
+
+	std::cout << "\n==== 所有测试完成！ ====\n";
+	return 0;
+}
@@ -1,41 +1,36 @@
 #include "IO/fileio.h"
+#include "cached_queue/tail_ring.h"
+#include "format/format_pool.h"
+#include "core/log_context.h"
 #include "core/logger_tools.h"
+#include "logger/crash_handler.h"
 #include "logger/logger.h"
+#include "logger/logger_config.h"
+#include "logger/logger_registry.h"
+#include "logger/sampling.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <coroutine>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <system_error>
 #include <thread>
-#include <unordered_map>
 #include <vector>
-class MockTools : public AbsLoggerTools {
-public:
-	std::string current_time() override { return "MOCK_TIME"; }
-	std::string thread_id() override { return "MOCK_THREAD"; }
-
-	const std::string& toString(LogLevel level) override {
-		static const std::unordered_map<LogLevel, std::string> levelMap = {
-			{ LogLevel::TRACE, "TRACE" }, { LogLevel::DEBUG, "DEBUG" }, { LogLevel::INFO, "INFO" }, { LogLevel::WARN, "WARN" }, { LogLevel::ERROR, "ERROR" }, { LogLevel::FATAL, "FATAL" }, { LogLevel::OFF, "OFF" }
-		};
-		return levelMap.at(level);
-	}
-
-	LogLevel fromString(const std::string& str) override {
-		static const std::unordered_map<std::string, LogLevel> levelMap = {
-			{ "trace", LogLevel::TRACE }, { "debug", LogLevel::DEBUG }, { "info", LogLevel::INFO }, { "warn", LogLevel::WARN }, { "error", LogLevel::ERROR }, { "fatal", LogLevel::FATAL }, { "off", LogLevel::OFF }
-		};
-		std::string lower = str;
-		std::transform(lower.begin(), lower.end(), lower.begin(),
-		               [](char c) { return std::tolower(c); });
-		return levelMap.at(lower);
-	}
-};
+#include <sys/wait.h>
+#include <unistd.h>
 
 void interface_test() {
 	std::cout << "==== 接口测试 ====" << std::endl;
-	auto tools = new MockTools;
+	std::remove("interface_test_log.txt");
 	auto io = new FileIO("interface_test_log.txt");
 
 	CCLogger logger(io);
@@ -45,8 +40,8 @@ void interface_test() {
 
 	std::cout << "接口测试：已写入 3 条日志。\n\n";
 
+	// sync_flush 返回时日志已经写入并落盘，无需再等待
 	logger.sync_flush();
-	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 	std::ifstream ifs("interface_test_log.txt");
 	std::string line;
 	int lineCount = 0;
@@ -54,13 +49,12 @@ void interface_test() {
 	while (std::getline(ifs, line))
 		++lineCount;
 	std::cout << lineCount << std::endl;
-	assert(lineCount >= count && "日志行数校验失败！");
-	std::cout << "日志完整性测试：文件中有 " << lineCount << " 条，期望 >= " << count << "\n\n";
+	assert(lineCount == count && "日志行数校验失败！");
+	std::cout << "日志完整性测试：文件中有 " << lineCount << " 条，期望 " << count << "\n\n";
 }
 
 void stress_test() {
 	std::cout << "==== 压力测试（高并发） ====" << std::endl;
-	auto tools = new MockTools;
 	auto io = new FileIO("stress_test_log.txt");
 
 	CCLogger logger(io);
@@ -92,7 +86,6 @@ void stress_test() {
 
 void edge_case_test() {
 	std::cout << "==== 边界条件测试 ====" << std::endl;
-	auto tools = new MockTools;
 	auto io = new FileIO("edge_case_log.txt");
 
 	CCLogger logger(io);
@@ -105,7 +98,7 @@ void edge_case_test() {
 
 void correctness_test() {
 	std::cout << "==== 正确性测试 ====" << std::endl;
-	auto tools = new MockTools;
+	std::remove("correctness_test_log.txt");
 	auto io = new FileIO("correctness_test_log.txt");
 	constexpr int count = 100;
 	CCLogger logger(io);
@@ -114,19 +107,881 @@ void correctness_test() {
 		logger.push_message("Line " + std::to_string(i));
 	}
 	logger.sync_flush();
-	std::this_thread::sleep_for(std::chrono::seconds(5));
 	std::ifstream ifs("correctness_test_log.txt");
 	std::string line;
 	int lineCount = 0;
 	while (std::getline(ifs, line))
 		++lineCount;
 	std::cout << lineCount << std::endl;
-	assert(lineCount >= count && "日志行数校验失败！");
-	std::cout << "日志完整性测试：文件中有 " << lineCount << " 条，期望 >= " << count << "\n\n";
+	assert(lineCount == count && "日志行数校验失败！");
+	std::cout << "日志完整性测试：文件中有 " << lineCount << " 条，期望 " << count << "\n\n";
+}
+
+void wait_strategy_test() {
+	std::cout << "==== 等待策略测试 ====" << std::endl;
+	const WaitStrategy strategies[] = { WaitStrategy::Blocking, WaitStrategy::BusySpin,
+		                                WaitStrategy::SpinYield, WaitStrategy::TimedBatch };
+	constexpr int count = 1000;
+	for (auto strategy : strategies) {
+		const std::string file = "wait_strategy_" + std::to_string(static_cast<int>(strategy)) + "_log.txt";
+		std::remove(file.c_str());
+		{
+			WaitPolicy policy;
+			policy.strategy = strategy;
+			policy.batch_threshold = 64;
+			CCLogger logger(new FileIO(file), policy);
+			std::vector<std::thread> threads;
+			for (int i = 0; i < 4; ++i) {
+				threads.emplace_back([&logger, i]() {
+					for (int j = 0; j < count / 4; ++j) {
+						logger.push_message("Thread " + std::to_string(i) + " log " + std::to_string(j));
+					}
+				});
+			}
+			for (auto& th : threads)
+				th.join();
+		}
+		// 析构时 worker 应写完队列中剩余的日志
+		std::ifstream ifs(file);
+		std::string line;
+		int lineCount = 0;
+		while (std::getline(ifs, line))
+			++lineCount;
+		assert(lineCount == count && "等待策略下日志丢失！");
+		std::cout << "策略 " << static_cast<int>(strategy) << "：文件中有 " << lineCount << " 条\n";
+	}
+	std::cout << "\n";
+}
+
+// 最简单的协程类型：立即开始执行，结束时自动销毁
+struct DetachedTask {
+	struct promise_type {
+		DetachedTask get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() { }
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+int count_lines(const std::string& file) {
+	std::ifstream ifs(file);
+	std::string line;
+	int lineCount = 0;
+	while (std::getline(ifs, line))
+		++lineCount;
+	return lineCount;
+}
+
+DetachedTask durable_writer(CCLogger& logger, const std::string& file, int count,
+                            std::atomic<int>& seen_lines) {
+	for (int i = 0; i < count - 1; ++i) {
+		logger.push_message("Durable " + std::to_string(i));
+	}
+	co_await logger.push_durable("Durable last");
+	// 恢复时所有日志必须已经落盘
+	seen_lines.store(count_lines(file));
+}
+
+void coroutine_flush_test() {
+	std::cout << "==== 协程刷新测试 ====" << std::endl;
+	constexpr int count = 100;
+	const std::string file = "coroutine_flush_log.txt";
+	std::remove(file.c_str());
+
+	// 默认由 worker 线程直接恢复协程
+	std::atomic<int> seen_lines { -1 };
+	{
+		CCLogger logger(new FileIO(file));
+		durable_writer(logger, file, count, seen_lines);
+		while (seen_lines.load() < 0)
+			std::this_thread::yield();
+	}
+	assert(seen_lines.load() == count && "协程恢复时日志未落盘！");
+
+	// 通过 hook 把协程交给调用方自己的 "执行器"
+	std::mutex posted_mutex;
+	std::vector<std::coroutine_handle<>> posted;
+	seen_lines.store(-1);
+	{
+		CCLogger logger(new FileIO(file));
+		logger.set_resume_hook([&](std::coroutine_handle<> h) {
+			std::lock_guard<std::mutex> lock(posted_mutex);
+			posted.push_back(h);
+		});
+		durable_writer(logger, file, count, seen_lines);
+		while (seen_lines.load() < 0) {
+			std::vector<std::coroutine_handle<>> batch;
+			{
+				std::lock_guard<std::mutex> lock(posted_mutex);
+				batch.swap(posted);
+			}
+			for (auto h : batch)
+				h.resume();
+		}
+	}
+	assert(seen_lines.load() == 2 * count && "hook 恢复时日志未落盘！");
+	std::cout << "协程刷新测试：恢复时文件中有 " << seen_lines.load() << " 条\n\n";
+}
+
+void stats_test() {
+	std::cout << "==== 统计快照测试 ====" << std::endl;
+	constexpr int count = 500;
+	CCLogger logger(new FileIO("stats_test_log.txt"));
+	for (int i = 0; i < count; ++i) {
+		logger.push_message("Stats " + std::to_string(i));
+	}
+	logger.sync_flush();
+
+	const LoggerStats stats = logger.stats();
+	assert(stats.enqueued == count && "入队计数错误！");
+	assert(stats.batch_records == count && "批次记录计数错误！");
+	assert(stats.queue_depth == 0);
+	assert(stats.batches >= 1 && stats.max_batch >= 1 && stats.max_batch <= count);
+	assert(stats.format_ns.count == count && stats.write_ns.count == count);
+	assert(stats.fsync_ns.count >= 1);
+	assert(stats.format_ns.percentile_ns(0.5) <= stats.format_ns.percentile_ns(0.99));
+	std::cout << "批次数 " << stats.batches << "，平均批大小 " << stats.avg_batch()
+	          << "，格式化 p50 " << stats.format_ns.percentile_ns(0.5) << " ns\n\n";
+}
+
+std::vector<std::string> read_lines(const std::string& file) {
+	std::ifstream ifs(file);
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(ifs, line))
+		lines.push_back(line);
+	return lines;
+}
+
+void rate_limit_test() {
+	std::cout << "==== 限流测试 ====" << std::endl;
+	const std::string file = "rate_limit_log.txt";
+	std::remove(file.c_str());
+	CCLogger logger(new FileIO(file));
+
+	// 每 10 条放行 1 条
+	int passed = 0;
+	for (int i = 0; i < 100; ++i) {
+		passed += logger.push_limited("every n " + std::to_string(i), RateLimit::every_n(10));
+	}
+	assert(passed == 10 && "EveryN 放行数量错误！");
+
+	// 令牌桶：速率极低时只放行突发容量
+	passed = 0;
+	for (int i = 0; i < 100; ++i) {
+		passed += logger.push_limited("bucket", RateLimit::token_bucket(0.001, 3));
+	}
+	assert(passed == 3 && "令牌桶放行数量错误！");
+
+	// 每秒前 N 条，循环可能跨过一次秒边界
+	passed = 0;
+	for (int i = 0; i < 1000; ++i) {
+		passed += logger.push_limited("first n", RateLimit::first_n_per_second(5));
+	}
+	assert(passed >= 5 && passed <= 10 && "每秒前 N 条放行数量错误！");
+
+	logger.sync_flush();
+	const auto lines = read_lines(file);
+	assert(lines.size() == static_cast<size_t>(13 + passed));
+	assert(lines[0] == "every n 0");
+	assert(lines[1] == "every n 10 (9 similar messages suppressed)");
+
+	// 被抑制的条数在该调用点下次放行时才计入
+	const LoggerStats stats = logger.stats();
+	assert(stats.suppressed >= 9 * 9);
+	std::cout << "限流测试：写入 " << lines.size() << " 条，已统计抑制 " << stats.suppressed << " 条\n\n";
+}
+
+void collapse_repeats_test() {
+	std::cout << "==== 重复消息折叠测试 ====" << std::endl;
+	const std::string file = "collapse_repeats_log.txt";
+	std::remove(file.c_str());
+	CCLogger logger(new FileIO(file));
+	logger.set_collapse_repeats(true);
+
+	for (int i = 0; i < 5; ++i)
+		logger.push_message("same");
+	logger.push_message("other");
+	logger.push_message("other");
+	logger.sync_flush();
+
+	const auto lines = read_lines(file);
+	assert(lines.size() == 4 && "折叠后的行数错误！");
+	assert(lines[0] == "same");
+	assert(lines[1] == "last message repeated 4 times");
+	assert(lines[2] == "other");
+	assert(lines[3] == "last message repeated 1 times");
+	assert(logger.stats().collapsed == 5);
+
+	// 文本相同但等级、命名日志器或 LogScope 不同的记录不折叠
+	logger.push_message(std::string_view("timeout"), LogLevel::WARN, 1);
+	logger.push_message(std::string_view("timeout"), LogLevel::ERROR, 1);
+	logger.push_message(std::string_view("timeout"), LogLevel::ERROR, 2);
+	logger.push_message(std::string_view("timeout"), LogLevel::ERROR, 2);
+	{
+		LogScope request { "req", 1 };
+		logger.push_message(std::string_view("timeout"), LogLevel::ERROR, 2);
+	}
+	{
+		LogScope request { "req", 2 };
+		logger.push_message(std::string_view("timeout"), LogLevel::ERROR, 2);
+	}
+	logger.sync_flush();
+	const auto mixed = read_lines(file);
+	const std::vector<std::string> expected = { "timeout", "timeout", "timeout", "last message repeated 1 times",
+		                                        "timeout", "timeout" };
+	assert(std::vector<std::string>(mixed.begin() + 4, mixed.end()) == expected && "不同来源的同文本记录被折叠！");
+	assert(logger.stats().collapsed == 6);
+	std::cout << "重复消息折叠测试：13 条消息写出 " << mixed.size() << " 行\n\n";
+}
+
+// 在子进程中写日志后崩溃，返回子进程的退出状态
+int crash_child(const std::string& file, bool terminate) {
+	const pid_t pid = fork();
+	if (pid == 0) {
+		WaitPolicy policy;
+		policy.strategy = WaitStrategy::TimedBatch;
+		policy.batch_interval = std::chrono::milliseconds(200);
+		policy.batch_threshold = 1000000;
+		auto* logger = new CCLogger(new FileIO(file), policy);
+		CrashHandler::install();
+		CrashHandler::watch(*logger);
+		// 这一批由后台线程写入 FileIO 的缓冲区，但没有 flush
+		for (int i = 0; i < 10; ++i)
+			logger->push_message("buffered " + std::to_string(i));
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		// 这一批还留在队列里
+		for (int i = 0; i < 10; ++i)
+			logger->push_message("queued " + std::to_string(i));
+		// 尚未由后台线程生成文本的延迟消息
+		logger->push_deferred([]() { return std::string("never rendered"); });
+		if (terminate)
+			std::terminate();
+		std::raise(SIGSEGV);
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return status;
+}
+
+void named_logger_test() {
+	std::cout << "==== 命名日志器测试 ====" << std::endl;
+	const std::string file = "named_logger_log.txt";
+	std::remove(file.c_str());
+	{
+		CCLogger backend(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		backend.set_formattor(format);
+		LoggerRegistry::set_backend(&backend);
+
+		NamedLogger& http = LoggerRegistry::get("net.http");
+		NamedLogger& net = LoggerRegistry::get("net");
+		NamedLogger& pool = LoggerRegistry::get("db.pool");
+		// 同名返回同一个句柄，祖先先于子孙创建
+		assert(&LoggerRegistry::get("net.http") == &http);
+		assert(http.get_parent() == &net && net.get_parent() == &LoggerRegistry::root());
+		assert(net.get_id() < http.get_id() && LoggerRegistry::name_of(http.get_id()) == "net.http");
+
+		// 级别沿层级继承
+		net.set_level(LogLevel::WARN);
+		assert(http.level() == LogLevel::WARN && pool.level() == LoggerRegistry::kDefaultLevel);
+		assert(!http.info("dropped") && http.warn("warn from http"));
+		assert(pool.info("info from pool") && !pool.debug("dropped"));
+		http.set_level(LogLevel::DEBUG);
+		assert(http.debug("debug from http"));
+		http.clear_level();
+		assert(!http.debug("dropped") && http.error("error from http"));
+		net.clear_level();
+		assert(http.info("info from http"));
+
+		// 未命名的消息仍打印格式化器的级别
+		backend.push_message("plain");
+		backend.sync_flush();
+	}
+	// 后端析构后自动注销，句柄丢弃消息
+	assert(LoggerRegistry::backend() == nullptr);
+	assert(!LoggerRegistry::get("db.pool").info("no backend"));
+
+	const auto lines = read_lines(file);
+	const std::vector<std::string> expected = {
+		"[WARN] [net.http] : warn from http",
+		"[INFO] [db.pool] : info from pool",
+		"[DEBUG] [net.http] : debug from http",
+		"[ERROR] [net.http] : error from http",
+		"[INFO] [net.http] : info from http",
+		"[INFO] : plain",
+	};
+	assert(lines == expected && "命名日志器输出错误！");
+	std::cout << "命名日志器：" << lines.size() << " 条日志共享同一个后台线程\n\n";
+}
+
+void backtrace_test() {
+	std::cout << "==== 回溯缓冲测试 ====" << std::endl;
+	const std::string file = "backtrace_log.txt";
+	std::remove(file.c_str());
+	{
+		CCLogger backend(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		backend.set_formattor(format);
+		LoggerRegistry::set_backend(&backend);
+
+		NamedLogger& logger = LoggerRegistry::get("bt");
+		logger.enable_backtrace(4);
+		// 低于级别的消息只进入环形缓冲区，保留最近 4 条
+		for (int i = 0; i < 10; ++i) {
+			assert(!logger.debug("debug " + std::to_string(i)));
+		}
+		logger.info("ok");
+		logger.error("boom");
+		// 已经输出过的不会重复输出
+		logger.error("boom again");
+		logger.trace("trace 0");
+		assert(logger.dump_backtrace() == 1);
+		logger.disable_backtrace();
+		logger.debug("dropped");
+		assert(logger.dump_backtrace() == 0);
+		backend.sync_flush();
+	}
+
+	const auto lines = read_lines(file);
+	const std::vector<std::string> expected = {
+		"[INFO] [bt] : ok",
+		"[INFO] [bt] : ---- backtrace: last 4 messages of bt ----",
+		"[DEBUG] [bt] : debug 6",
+		"[DEBUG] [bt] : debug 7",
+		"[DEBUG] [bt] : debug 8",
+		"[DEBUG] [bt] : debug 9",
+		"[INFO] [bt] : ---- end of backtrace of bt ----",
+		"[ERROR] [bt] : boom",
+		"[ERROR] [bt] : boom again",
+		"[INFO] [bt] : ---- backtrace: last 1 messages of bt ----",
+		"[TRACE] [bt] : trace 0",
+		"[INFO] [bt] : ---- end of backtrace of bt ----",
+	};
+	assert(lines == expected && "回溯缓冲输出错误！");
+	std::cout << "回溯缓冲：错误发生时输出最近 4 条调试日志\n\n";
+}
+
+void sampling_test() {
+	std::cout << "==== 采样测试 ====" << std::endl;
+	// 比率 0 全部丢弃，比率 1 全部保留
+	SampledSite never { 0.0 };
+	SampledSite always { 1.0 };
+	for (int i = 0; i < 1000; ++i) {
+		assert(!never.draw());
+		assert(always.draw() && always.draw().rate == 1.0f);
+	}
+	// 比率 0.1 的保留数量应接近 10%
+	SampledSite tenth { 0.1 };
+	int kept = 0;
+	for (int i = 0; i < 100000; ++i) {
+		if (const Sample sample = tenth.draw()) {
+			assert(std::abs(sample.rate - 0.1f) < 1e-6f);
+			++kept;
+		}
+	}
+	assert(kept > 9000 && kept < 11000 && "采样比例偏差过大！");
+	// 运行时调整比率
+	tenth.set_rate(0.5);
+	assert(std::abs(tenth.rate() - 0.5) < 1e-9);
+
+	const std::string file = "sampling_log.txt";
+	std::remove(file.c_str());
+	{
+		CCLogger backend(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		backend.set_formattor(format);
+		LoggerRegistry::set_backend(&backend);
+
+		NamedLogger& logger = LoggerRegistry::get("sampled");
+		logger.set_level(LogLevel::DEBUG);
+		Sampler::set_rate(LogLevel::DEBUG, 0.0);
+		assert(!logger.debug("dropped"));
+		Sampler::set_rate(LogLevel::DEBUG, 0.25);
+		while (!logger.debug("kept")) { }
+		Sampler::set_rate(LogLevel::DEBUG, 1.0);
+		assert(logger.debug("all"));
+		backend.sync_flush();
+	}
+
+	const auto lines = read_lines(file);
+	const std::vector<std::string> expected = {
+		"[DEBUG] [sampled] [sample_rate=0.25] : kept",
+		"[DEBUG] [sampled] : all",
+	};
+	assert(lines == expected && "采样比率未写入日志！");
+	std::cout << "采样：比率 0.1 保留 " << kept << " / 100000 条\n\n";
+}
+
+void format_pool_test() {
+	std::cout << "==== 并行格式化测试 ====" << std::endl;
+	const std::string file = "format_pool_log.txt";
+	std::remove(file.c_str());
+	constexpr int producers = 4;
+	constexpr int per_producer = 5000;
+	{
+		// 攒批让每批足够大，能切分给格式化线程
+		WaitPolicy policy;
+		policy.strategy = WaitStrategy::TimedBatch;
+		policy.batch_threshold = 1024;
+		policy.batch_interval = std::chrono::milliseconds(5);
+		CCLogger logger(new FileIO(file), policy);
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_srcLocation(false);
+		logger.set_formattor(format);
+		logger.set_format_threads(3);
+		assert(logger.get_format_threads() == 3);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < producers; ++t) {
+			threads.emplace_back([&logger, t]() {
+				for (int i = 0; i < per_producer; ++i) {
+					logger.push_message(std::to_string(t) + " " + std::to_string(i));
+				}
+			});
+		}
+		for (auto& th : threads) {
+			th.join();
+		}
+		logger.sync_flush();
+		// 运行中关闭线程池，后续批次回到后台线程串行格式化
+		logger.set_format_threads(0);
+		logger.push_message(std::string("tail"));
+		logger.sync_flush();
+	}
+
+	// 每个生产者的消息必须按推送顺序出现
+	const auto lines = read_lines(file);
+	assert(lines.size() == producers * per_producer + 1 && "并行格式化丢失日志！");
+	std::vector<int> next(producers, 0);
+	for (size_t i = 0; i + 1 < lines.size(); ++i) {
+		const auto body = lines[i].substr(lines[i].rfind(": ") + 2);
+		const int producer = std::stoi(body);
+		assert(std::stoi(body.substr(body.find(' ') + 1)) == next[producer]++ && "并行格式化打乱了顺序！");
+	}
+	assert(lines.back().ends_with(": tail"));
+	std::cout << "并行格式化：" << lines.size() << " 行，每个生产者内顺序不变\n\n";
+}
+
+void zero_copy_test() {
+	std::cout << "==== 零拷贝推送测试 ====" << std::endl;
+	const std::string file = "zero_copy_log.txt";
+	std::remove(file.c_str());
+	const std::string long_text(LogMessage::kInlineCapacity * 2, 'z');
+	{
+		CCLogger logger(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		logger.set_formattor(format);
+		logger.push_static("static literal");
+		logger.push_static("static warning", LogLevel::WARN);
+		logger.push_message(std::string(long_text));
+		logger.push_message(std::string("short moved"));
+		logger.sync_flush();
+	}
+
+	const auto lines = read_lines(file);
+	const std::vector<std::string> expected = {
+		"[INFO] : static literal",
+		"[WARN] : static warning",
+		"[INFO] : " + long_text,
+		"[INFO] : short moved",
+	};
+	assert(lines == expected && "零拷贝推送输出错误！");
+	std::cout << "零拷贝推送：字面量与移动的字符串均按原样输出\n\n";
+}
+
+void tail_test() {
+	std::cout << "==== 日志尾部快照测试 ====" << std::endl;
+	CCLogger logger(new FileIO("tail_log.txt"));
+	auto format = new DefLoggerFormatFactory;
+	format->set_enable_time(false);
+	format->set_enable_threadid(false);
+	format->set_enable_srcLocation(false);
+	logger.set_formattor(format);
+	logger.push_message(std::string("before tail"));
+	logger.sync_flush();
+
+	TailRing& tail = logger.enable_tail(3);
+	assert(&logger.enable_tail() == &tail && logger.get_tail() == &tail);
+	for (int i = 0; i < 5; ++i) {
+		logger.push_message("tail " + std::to_string(i));
+	}
+	logger.sync_flush();
+	const std::vector<std::string> expected = { "[INFO] : tail 2", "[INFO] : tail 3", "[INFO] : tail 4" };
+	assert(tail.snapshot() == expected && "尾部快照内容错误！");
+
+	// 关闭后不再记录，已有快照仍可读取
+	logger.disable_tail();
+	logger.push_message(std::string("after tail"));
+	logger.sync_flush();
+	assert(logger.get_tail() == nullptr && tail.snapshot() == expected);
+	std::cout << "尾部快照：保留最近 3 行\n\n";
+}
+
+void config_test() {
+	std::cout << "==== 配置文件与热加载测试 ====" << std::endl;
+	// 解析：分节、注释、默认值
+	const LoggerConfig parsed = LoggerConfig::parse("sink = file:app.log  # 注释\n"
+	                                                "; 整行注释\n"
+	                                                "[format]\n"
+	                                                "time = off\n"
+	                                                "level = WARN\n"
+	                                                "[logger]\n"
+	                                                "net.http = DEBUG\n"
+	                                                "net.http = TRACE\n"
+	                                                "[sample]\n"
+	                                                "TRACE = 0.25\n");
+	assert(parsed.sink == "file:app.log" && !parsed.format_time && parsed.format_thread);
+	assert(parsed.format_level == LogLevel::WARN && parsed.level == LogLevel::INFO);
+	assert(parsed.logger_levels.size() == 1 && parsed.logger_levels[0].second == LogLevel::TRACE);
+	assert(parsed.sample_rates[Weight(LogLevel::TRACE)] == 0.25 && parsed.sample_rates[Weight(LogLevel::INFO)] == 1.0);
+	// 值中间的 # 与 ; 不是注释，行首或空白之后才是
+	const LoggerConfig inline_marks = LoggerConfig::parse("sink = file:/var/log/a;b#1.log\t; 注释\n"
+	                                                      "#level = ERROR\n");
+	assert(inline_marks.sink == "file:/var/log/a;b#1.log" && "值中的分号被当作注释！");
+	// "WARN;" 前没有空白，分号属于值，应当报错
+	bool rejected = false;
+	try {
+		LoggerConfig::parse("level = WARN;\n");
+	} catch (const std::invalid_argument&) {
+		rejected = true;
+	}
+	assert(rejected && inline_marks.level == LogLevel::INFO);
+	// 错误信息指出行号
+	for (const char* bad : { "level = INFO\n[format]\ncolour = red\n", "level = INFO\n\nlevel = LOUD\n",
+	                         "sink = ftp:host\n\n\n", "[sample]\nINFO = 2\n\n" }) {
+		try {
+			LoggerConfig::parse(bad);
+			assert(false && "非法配置应当抛出异常！");
+		} catch (const std::invalid_argument& e) {
+			const std::string what = e.what();
+			assert((what.starts_with("line 3:") || what.starts_with("line 1:") || what.starts_with("line 2:")) && "错误信息缺少行号！");
+		}
+	}
+
+	// 环境变量覆盖文件中的设置
+	::setenv("CCLOGGER_OPTIONS", "format.source=off; level=ERROR;", 1);
+	LoggerConfig overridden = parsed;
+	overridden.apply_env();
+	::unsetenv("CCLOGGER_OPTIONS");
+	assert(!overridden.format_source && overridden.level == LogLevel::ERROR && overridden.sink == parsed.sink);
+
+	const std::string conf = "config_test.conf";
+	const std::string first = "config_first_log.txt";
+	const std::string second = "config_second_log.txt";
+	for (const auto& file : { conf, first, second }) {
+		std::remove(file.c_str());
+	}
+
+	// reconfigure() 之前已入队的记录仍用旧输出写出
+	{
+		WaitPolicy policy;
+		policy.strategy = WaitStrategy::TimedBatch;
+		policy.batch_threshold = 1 << 20;
+		policy.batch_interval = std::chrono::seconds(10);
+		CCLogger logger(new FileIO(first), policy);
+		for (int i = 0; i < 100; ++i) {
+			logger.push_message("queued " + std::to_string(i));
+		}
+		logger.reconfigure(new FileIO(second), nullptr);
+		// 与 LoggerConfig::apply() 相同：sync_flush 返回时新输出已生效
+		logger.sync_flush();
+		logger.push_message(std::string("after"));
+		logger.sync_flush();
+	}
+	assert(read_lines(first).size() == 100 && read_lines(second) == std::vector<std::string> { "after" }
+	       && "切换前入队的记录被写入了新输出！");
+	std::remove(first.c_str());
+	std::remove(second.c_str());
+	const auto write_conf = [&conf](const std::string& text) {
+		// 先写临时文件再改名，与编辑器保存的方式相同
+		const std::string temp = conf + ".tmp";
+		std::ofstream(temp) << text;
+		std::rename(temp.c_str(), conf.c_str());
+	};
+	const auto wait_reloads = [](const ConfigWatcher& watcher, uint64_t count) {
+		for (int i = 0; i < 500 && watcher.reloads() < count; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return watcher.reloads() >= count;
+	};
+	write_conf("sink = file:" + first + "\n"
+	           "level = WARN\n"
+	           "[format]\n"
+	           "time = false\nthread = false\nsource = false\n");
+	{
+		CCLogger logger(new FileIO("/dev/null"));
+		LoggerRegistry::set_backend(&logger);
+		NamedLogger& db = LoggerRegistry::get("cfg.db");
+		ConfigWatcher watcher(logger, conf);
+		assert(watcher.reloads() == 1 && watcher.last_error().empty());
+		assert(!db.info("dropped") && db.warn("warn from db"));
+		logger.push_message(std::string("plain"));
+		logger.sync_flush();
+
+		// 改级别、格式与输出目标，生产者无需暂停
+		std::atomic<bool> stop { false };
+		std::thread producer([&logger, &stop]() {
+			while (!stop.load()) {
+				logger.push_message(std::string_view("during reload"), LogLevel::INFO);
+			}
+		});
+		write_conf("sink = file:" + second + "\n"
+		           "[format]\n"
+		           "time = false\nthread = false\nsource = false\npadding = true\n"
+		           "[logger]\n"
+		           "cfg.db = DEBUG\n");
+		assert(wait_reloads(watcher, 2) && "配置修改后没有重新加载！");
+		stop.store(true);
+		producer.join();
+		assert(db.debug("debug from db") && LoggerRegistry::root().level() == LogLevel::INFO);
+		logger.sync_flush();
+
+		// 无法解析的文件保留原配置
+		std::ofstream(conf) << "level = INFO\nbogus = 1\n";
+		for (int i = 0; i < 500 && watcher.last_error().empty(); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		assert(watcher.last_error().find("line 2") != std::string::npos && watcher.reloads() == 2);
+		assert(watcher.current().sink == "file:" + second && db.debug("still debug"));
+		logger.sync_flush();
+	}
+	LoggerRegistry::get("cfg.db").clear_level();
+
+	// 切换前的行用旧格式写入旧文件，之后的行用新格式写入新文件，没有残缺的行
+	const auto before = read_lines(first);
+	assert(before.size() >= 2 && before[0] == "[WARN] [cfg.db] : warn from db" && before[1] == "[INFO] : plain");
+	assert(std::all_of(before.begin() + 2, before.end(), [](const auto& line) { return line == "[INFO] : during reload"; }));
+	const auto lines = read_lines(second);
+	assert(lines.size() >= 2 && lines[lines.size() - 2] == "[DEBUG] [cfg.db] : debug from db" && lines.back() == "[DEBUG] [cfg.db] : still debug");
+	assert(std::all_of(lines.begin(), lines.end() - 2, [](const auto& line) { return line == "[INFO ] : during reload"; })
+	       && "热加载期间出现了旧格式或残缺的行！");
+	std::cout << "配置热加载：切换后 " << lines.size() << " 行写入新文件\n\n";
+}
+
+void lazy_test() {
+	std::cout << "==== 延迟求值测试 ====" << std::endl;
+	const std::string file = "lazy_log.txt";
+	std::remove(file.c_str());
+	int calls = 0;
+	std::thread::id rendered_on;
+	{
+		CCLogger backend(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		backend.set_formattor(format);
+		LoggerRegistry::set_backend(&backend);
+		NamedLogger& svc = LoggerRegistry::get("lazy.svc");
+		const auto describe = [&calls]() {
+			++calls;
+			return std::string("described");
+		};
+
+		// 被级别过滤或采样丢弃的消息不求值
+		assert(!svc.debug(describe) && calls == 0);
+		assert(svc.info(describe) && calls == 1);
+		Sampler::set_rate(LogLevel::INFO, 0.0);
+		assert(!svc.info(describe) && calls == 1);
+		Sampler::set_rate(LogLevel::INFO, 1.0);
+
+		// 宏只在消息会被记录时才计算参数并格式化
+		const auto expensive = [&calls]() {
+			++calls;
+			return std::string("expensive");
+		};
+		assert(!CCLOGGER_DEBUG(svc, "n={} {}", 41, expensive()) && calls == 1);
+		assert(CCLOGGER_WARN(svc, "n={} {}", 42, expensive()) && calls == 2);
+
+		// on_worker：按值捕获的生成函数在后台线程执行
+		const auto on_worker_maker = [&rendered_on, values = std::vector<int> { 1, 2, 3 }]() {
+			rendered_on = std::this_thread::get_id();
+			return "vector of " + std::to_string(values.size());
+		};
+		assert(!svc.debug(on_worker(on_worker_maker)) && rendered_on == std::thread::id {});
+		assert(svc.info(on_worker(on_worker_maker)));
+		backend.push_deferred([]() { return std::string("deferred direct"); }, LogLevel::ERROR);
+		backend.sync_flush();
+		assert(rendered_on != std::thread::id {} && rendered_on != std::this_thread::get_id() && "生成函数没有在后台线程执行！");
+
+		// 开启 backtrace 时，低于级别的消息为保存进环形缓冲区而求值
+		svc.enable_backtrace(4);
+		assert(!svc.debug(describe) && calls == 3);
+		svc.disable_backtrace();
+	}
+
+	const auto lines = read_lines(file);
+	const std::vector<std::string> expected = {
+		"[INFO] [lazy.svc] : described",
+		"[WARN] [lazy.svc] : n=42 expensive",
+		"[INFO] [lazy.svc] : vector of 3",
+		"[ERROR] : deferred direct",
+	};
+	assert(lines == expected && "延迟求值的输出错误！");
+	std::cout << "延迟求值：" << calls << " 次求值，被丢弃的消息不求值\n\n";
+}
+
+void log_scope_test() {
+	std::cout << "==== 上下文字段测试 ====" << std::endl;
+	const std::string file = "log_scope_log.txt";
+	std::remove(file.c_str());
+	{
+		CCLogger logger(new FileIO(file));
+		auto format = new DefLoggerFormatFactory;
+		format->set_enable_time(false);
+		format->set_enable_threadid(false);
+		format->set_enable_srcLocation(false);
+		logger.set_formattor(format);
+
+		logger.push_message("outside");
+		{
+			LogScope request { "req", 42 };
+			logger.push_message("in request");
+			{
+				LogScope tenant { "tenant", "acme" };
+				assert(LogContext::current_text() == "req=42 tenant=acme");
+				logger.push_message("in tenant");
+				// 超过内联容量的消息走另一条入队路径
+				logger.push_message(std::string(LogMessage::kInlineCapacity + 1, 'x'));
+			}
+			logger.push_message("back in request");
+		}
+		assert(LogContext::current_text().empty());
+		// 作用域已经结束，后台线程仍能通过记录持有的引用输出字段
+		std::thread([&logger]() {
+			LogScope other { "req", "from another thread" };
+			logger.push_message("other thread");
+		}).join();
+		logger.sync_flush();
+	}
+
+	const auto lines = read_lines(file);
+	assert(lines.size() == 6);
+	assert(lines[0] == "[INFO] : outside");
+	assert(lines[1] == "[INFO] [req=42] : in request");
+	assert(lines[2] == "[INFO] [req=42 tenant=acme] : in tenant");
+	assert(lines[3].rfind("[INFO] [req=42 tenant=acme] : xxx", 0) == 0);
+	assert(lines[4] == "[INFO] [req=42] : back in request");
+	assert(lines[5] == "[INFO] [req=from another thread] : other thread");
+	std::cout << "上下文字段：" << lines[2] << "\n\n";
+}
+
+void placement_test() {
+	std::cout << "==== 后台线程放置测试 ====" << std::endl;
+	const std::string file = "placement_log.txt";
+	std::remove(file.c_str());
+	ThreadPlacement placement;
+	placement.cpus = { 0 };
+	placement.nice = 5;
+	placement.numa_local_memory = true;
+	placement.reserved_slots = 1024;
+	assert(!placement.is_default() && ThreadPlacement {}.is_default());
+	{
+		CCLogger logger(new FileIO(file), {}, placement);
+		assert(logger.get_placement().cpus == placement.cpus);
+		for (int i = 0; i < 2000; ++i) {
+			logger.push_message("placed " + std::to_string(i));
+		}
+		logger.sync_flush();
+	}
+	assert(read_lines(file).size() == 2000 && "绑核后日志丢失！");
+
+	// 并行格式化的辅助线程与后台线程绑在同一组 CPU 上，调用线程自己格式化的第一块不计
+	struct AffinityFormat : LoggerFormatFactory {
+		std::thread::id caller { std::this_thread::get_id() };
+		std::atomic<int> placed { 0 };
+		std::atomic<int> unplaced { 0 };
+		std::string format(const std::string_view message, const std::source_location&) override {
+			if (std::this_thread::get_id() != caller) {
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				const bool pinned = ::sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) == 1
+				    && CPU_ISSET(0, &set);
+				++(pinned ? placed : unplaced);
+			}
+			return std::string(message);
+		}
+	} affinity;
+	{
+		FormatPool pool(3, placement);
+		std::vector<LogRecord> records(4 * FormatPool::kMinChunk);
+		std::vector<std::string> formatted(records.size());
+		pool.format(affinity, records.data(), records.size(), formatted.data());
+	}
+	assert(affinity.placed.load() == 3 * static_cast<int>(FormatPool::kMinChunk) && affinity.unplaced.load() == 0
+	       && "格式化线程未应用 placement！");
+
+	// 不存在的 CPU：构造函数抛出异常，后台线程已回收
+	placement.cpus = { CPU_SETSIZE - 1 };
+	bool thrown = false;
+	try {
+		CCLogger logger(new FileIO(file), {}, placement);
+	} catch (const std::system_error& e) {
+		thrown = e.code().value() == EINVAL;
+	}
+	assert(thrown && "无效 CPU 未报错！");
+	std::cout << "后台线程放置：绑核、nice 与 NUMA 预留均生效，无效配置抛出异常\n\n";
+}
+
+void crash_flush_test() {
+	std::cout << "==== 崩溃落盘测试 ====" << std::endl;
+#ifdef CCLOGGER_SANITIZED
+	// 消毒器自己接管了致命信号，与崩溃处理器不能共存
+	std::cout << "崩溃落盘测试：消毒器构建下跳过\n\n";
+	return;
+#endif
+	const std::string file = "crash_flush_log.txt";
+	for (bool terminate : { false, true }) {
+		std::remove(file.c_str());
+		const int status = crash_child(file, terminate);
+		// 信号被重新抛出，退出状态不变
+		assert(WIFSIGNALED(status) && WTERMSIG(status) == (terminate ? SIGABRT : SIGSEGV));
+
+		const auto lines = read_lines(file);
+		assert(lines.size() == 22 && "崩溃时日志丢失！");
+		assert(lines[0] == "buffered 0");
+		assert(lines[10].rfind("CCLogger: ", 0) == 0);
+		assert(lines[11] == std::string(CrashHandler::kEmergencyPrefix) + "queued 0");
+		assert(lines[20] == std::string(CrashHandler::kEmergencyPrefix) + "queued 9");
+		assert(lines[21] == std::string(CrashHandler::kEmergencyPrefix) + CrashHandler::kUnrenderedMessage
+		       && "未生成的延迟消息在崩溃时写成了空行！");
+	}
+	std::cout << "崩溃落盘测试：SIGSEGV 与 std::terminate 均未丢失日志\n\n";
 }
 
 int main() {
 	interface_test();
+	stats_test();
+	rate_limit_test();
+	collapse_repeats_test();
+	named_logger_test();
+	backtrace_test();
+	sampling_test();
+	format_pool_test();
+	zero_copy_test();
+	tail_test();
+	config_test();
+	lazy_test();
+	log_scope_test();
+	placement_test();
+	crash_flush_test();
+	coroutine_flush_test();
+	wait_strategy_test();
 	edge_case_test();
 	correctness_test();
 	stress_test();
@@ -1,9 +1,23 @@
 #include "cached_queue/logger_queue.h"
+#include "cached_queue/shm_ring.h"
+#include "cached_queue/tail_ring.h"
+#include "logger/shm_logger.h"
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // 测试常量
 constexpr int THREAD_COUNT = 10;
@@ -122,10 +136,10 @@ void functional_test() {
 	// 测试入队
 	queue.enqueue("Test1");
 	assert(queue.size() == 1);
-	assert(queue.current_left().front() == "Test1");
+	assert(queue.current_left().front().message == "Test1");
 
 	// 测试出队
-	assert(queue.dequeue() == "Test1");
+	assert(queue.dequeue().message == "Test1");
 	assert(queue.size() == 0);
 
 	// 测试清空
@@ -138,11 +152,295 @@ void functional_test() {
 	std::cout << "Functional test passed." << std::endl;
 }
 
+void message_storage_test() {
+	// 短消息直接存放在槽位内
+	LogMessage short_msg("short");
+	assert(!short_msg.spilled());
+	assert(short_msg == "short");
+
+	// 超过内联容量的消息溢出到池中
+	const std::string long_text(LogMessage::kInlineCapacity + 1, 'x');
+	LogMessage long_msg(long_text);
+	assert(long_msg.spilled());
+	assert(long_msg == long_text);
+
+	// 移动后源对象为空，内容不丢失
+	LogMessage moved(std::move(long_msg));
+	assert(moved.spilled() && moved == long_text);
+	assert(long_msg.empty() && !long_msg.spilled());
+
+	// 重新赋值为短消息后归还溢出缓冲区
+	moved.assign("tiny");
+	assert(!moved.spilled() && moved == "tiny");
+
+	// 归还的缓冲区会被复用
+	const char* first = nullptr;
+	{
+		LogMessage a(long_text);
+		first = a.data();
+	}
+	LogMessage b(long_text);
+	assert(b.data() == first);
+
+	// 队列中的长短消息
+	LoggerQueue queue;
+	queue.enqueue(std::string_view("inline"));
+	queue.enqueue(std::string_view(long_text));
+	std::vector<LogRecord> batch;
+	queue.drain(batch);
+	assert(batch.size() == 2);
+	assert(batch[0].message == "inline" && !batch[0].message.spilled());
+	assert(batch[1].message == long_text && batch[1].message.spilled());
+
+	std::cout << "Message storage test passed." << std::endl;
+}
+
+void zero_copy_test() {
+	// 字面量只记录指针与长度
+	static constexpr char kBanner[] = "static banner";
+	LogMessage literal;
+	literal.borrow("literal");
+	assert(literal.borrowed() && !literal.spilled() && literal == "literal");
+	literal.borrow(StaticText::from_static(kBanner));
+	assert(literal.data() == kBanner);
+
+	// 拷贝与移动仍然引用同一段静态文本
+	LogMessage copied(literal);
+	assert(copied.borrowed() && copied.data() == kBanner);
+	LogMessage moved(std::move(copied));
+	assert(moved.borrowed() && moved.data() == kBanner && copied.empty());
+
+	// 长字符串接管其堆缓冲区，移动过程中不拷贝
+	std::string long_text(LogMessage::kInlineCapacity + 100, 'y');
+	const std::string expected = long_text;
+	const char* buffer = long_text.data();
+	LogMessage adopted;
+	adopted.adopt(std::move(long_text));
+	assert(adopted.spilled() && adopted.data() == buffer && adopted == expected);
+	LogMessage taken(std::move(adopted));
+	assert(taken.data() == buffer && adopted.empty());
+	taken.assign("short again");
+	assert(!taken.spilled() && taken == "short again");
+
+	// 短字符串仍然拷贝进内联缓冲区
+	LogMessage small;
+	small.adopt(std::string("small"));
+	assert(!small.spilled() && small == "small");
+
+	// 经过队列后仍指向原始字面量
+	LoggerQueue queue;
+	queue.enqueue_static(StaticText::from_static(kBanner), LogLevel::WARN);
+	std::vector<LogRecord> batch;
+	queue.drain(batch);
+	assert(batch.size() == 1 && batch[0].message.data() == kBanner && batch[0].level == LogLevel::WARN);
+
+	std::cout << "Zero-copy test passed." << std::endl;
+}
+
+void deferred_message_test() {
+	// 延迟消息在 render() 之前为空，不调用生成函数
+	int calls = 0;
+	std::string name = "deferred"; // const 成员会让闭包的移动构造可能抛出异常，无法延迟
+	LogMessage message;
+	message.defer([&calls, name]() {
+		++calls;
+		return name + " text";
+	});
+	assert(message.deferred() && message.empty() && !message.spilled() && calls == 0);
+
+	// 拷贝与移动带上生成函数本身，经过队列也不提前求值
+	LogMessage copied(message);
+	LogMessage moved(std::move(message));
+	assert(copied.deferred() && moved.deferred() && !message.deferred() && calls == 0);
+	LogRecord record;
+	record.message = std::move(moved);
+	LoggerQueue queue;
+	queue.enqueue(std::move(record));
+	// current_left() 在副本上生成文本，队列中的记录仍是延迟的
+	const auto left = queue.current_left();
+	assert(left.size() == 1 && left[0].message == "deferred text" && calls == 1);
+	std::vector<LogRecord> batch;
+	queue.drain(batch);
+	assert(batch.size() == 1 && batch[0].message.deferred() && calls == 1);
+	batch[0].message.render();
+	copied.render();
+	assert(!batch[0].message.deferred() && batch[0].message == "deferred text" && copied == "deferred text" && calls == 3);
+	copied.render();
+	assert(calls == 3);
+
+	// 超出内联容量的长文本被接管
+	LogMessage long_message;
+	long_message.defer([]() { return std::string(LogMessage::kInlineCapacity * 2, 'z'); });
+	long_message.render();
+	assert(long_message.spilled() && long_message.size() == LogMessage::kInlineCapacity * 2);
+
+	// 生成函数抛出异常时留下说明
+	LogMessage throwing;
+	throwing.defer([]() -> std::string { throw std::runtime_error("boom"); });
+	throwing.render();
+	assert(throwing == "<log message threw: boom>");
+
+	// 放不进槽位的生成函数立即求值
+	struct Big {
+		char payload[LogMessage::kInlineCapacity] {};
+	};
+	static_assert(!LogMessage::kDeferrable<decltype([big = Big {}]() { return std::string(big.payload); })>);
+	LogMessage eager;
+	eager.defer([big = Big {}, &calls]() {
+		++calls;
+		return std::string("eager") + big.payload;
+	});
+	assert(!eager.deferred() && eager == "eager" && calls == 4);
+
+	std::cout << "Deferred message test passed." << std::endl;
+}
+
+void tail_ring_test() {
+	// 只保留最近的 capacity 行，去掉行尾换行，超长行被截断
+	TailRing ring(4);
+	assert(ring.snapshot().empty());
+	for (int i = 0; i < 10; ++i) {
+		ring.push("line " + std::to_string(i) + "\n");
+	}
+	assert(ring.pushed() == 10);
+	const std::vector<std::string> expected = { "line 6", "line 7", "line 8", "line 9" };
+	assert(ring.snapshot() == expected);
+	assert(ring.snapshot(2) == std::vector<std::string>({ "line 8", "line 9" }));
+	ring.push(std::string(TailRing::kLineCapacity + 10, 'x'));
+	assert(ring.snapshot(1).front() == std::string(TailRing::kLineCapacity, 'x'));
+
+	// 读者与写者并发：读到的每一行都必须完整且按顺序
+	TailRing shared(64);
+	std::atomic<bool> done { false };
+	std::thread writer([&]() {
+		for (int i = 0; i < 200000; ++i) {
+			const char fill = static_cast<char>('a' + i % 26);
+			shared.push(std::to_string(i) + ":" + std::string(static_cast<size_t>(i % 300), fill));
+		}
+		done.store(true);
+	});
+	size_t seen = 0;
+	while (!done.load()) {
+		long last = -1;
+		for (const auto& line : shared.snapshot()) {
+			const auto colon = line.find(':');
+			assert(colon != std::string::npos && "读到被撕裂的行！");
+			const long number = std::stol(line.substr(0, colon));
+			assert(number > last && "快照顺序错误！");
+			last = number;
+			const std::string body = line.substr(colon + 1);
+			assert(body.size() == static_cast<size_t>(number % 300) && "读到被撕裂的行！");
+			assert(body.find_first_not_of(static_cast<char>('a' + number % 26)) == std::string::npos && "读到被撕裂的行！");
+			++seen;
+		}
+	}
+	writer.join();
+	assert(shared.snapshot().back().starts_with("199999:"));
+
+	std::cout << "Tail ring test passed. Lines checked: " << seen << std::endl;
+}
+
+void shm_ring_test() {
+	const std::string name = "/cclogger-test-" + std::to_string(getpid());
+	ShmRing::unlink(name);
+	// 容量很小，保证多次回绕
+	auto ring = ShmRing::attach(name, 4096);
+	assert(ring->capacity() == 4096);
+
+	constexpr int kProducers = 2;
+	constexpr int kPerProducer = 5000;
+	std::vector<pid_t> children;
+	for (int p = 0; p < kProducers; ++p) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			// 子进程：通过 ShmLogger 写入，满了就重试，写完直接退出（不 flush）
+			ShmLogger logger(name);
+			for (int i = 0; i < kPerProducer; ++i) {
+				const std::string msg = "producer " + std::to_string(p) + " message " + std::to_string(i);
+				while (!logger.push_message(msg))
+					std::this_thread::yield();
+			}
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+
+	// 父进程作为读者，每个生产者内部必须保持顺序
+	std::vector<int> next(kProducers, 0);
+	int received = 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (received < kProducers * kPerProducer && std::chrono::steady_clock::now() < deadline) {
+		received += ring->read([&](const ShmEntry& entry) {
+			int p = -1;
+			int i = -1;
+			const int fields = std::sscanf(std::string(entry.message).c_str(), "producer %d message %d", &p, &i);
+			assert(fields == 2);
+			assert(p >= 0 && p < kProducers && i == next[p] && "共享内存记录乱序！");
+			assert(entry.pid == static_cast<uint32_t>(children[p]));
+			assert(entry.timestamp_ns > 0);
+			++next[p];
+		});
+	}
+	for (pid_t pid : children) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	assert(received == kProducers * kPerProducer && "共享内存记录丢失！");
+	assert(ring->read_position() == ring->write_position());
+
+	// 超过一半容量的消息会被丢弃并计数
+	const uint64_t dropped = ring->dropped();
+	assert(!ring->try_write(std::string(3000, 'x'), 1, 1, 1));
+	assert(ring->dropped() == dropped + 1);
+
+	// 崩溃或损坏的写者留下的非法记录头：读者不能原地打转，也不能越界
+	const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+	assert(fd >= 0);
+	struct stat info {};
+	::fstat(fd, &info);
+	const size_t mapped = static_cast<size_t>(info.st_size);
+	void* mapping = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	assert(mapping != MAP_FAILED);
+	// 数据区位于映射末尾，记录头依次为 state、size、pid、tid、timestamp、length
+	char* data = static_cast<char*>(mapping) + mapped - ring->capacity();
+	const auto corrupt = [&](uint32_t size, uint32_t length) {
+		const uint64_t position = ring->write_position();
+		assert(ring->try_write("bogus", 1, 1, 1) && ring->try_write("after", 1, 1, 1));
+		char* record = data + (position & (ring->capacity() - 1));
+		std::memcpy(record + 4, &size, sizeof(size));
+		std::memcpy(record + 24, &length, sizeof(length));
+		int visited = 0;
+		const size_t count = ring->read([&visited](const ShmEntry&) { ++visited; });
+		assert(count == 0 && visited == 0 && "非法记录被交给了回调！");
+		assert(ring->read_position() == ring->write_position() && "读者卡在了非法记录上！");
+		// 丢弃之后的记录照常读取
+		assert(ring->try_write("next", 1, 1, 1));
+		std::string next;
+		assert(ring->read([&next](const ShmEntry& entry) { next = entry.message; }) == 1 && next == "next");
+	};
+	corrupt(0, 5);
+	corrupt(0xfffffff0u, 5);
+	corrupt(40, 5);
+	corrupt(32, 0xffffffffu);
+	::munmap(mapping, mapped);
+
+	ShmRing::unlink(name);
+	std::cout << "Shared memory ring test passed. Wrap arounds: " << ring->write_position() / ring->capacity()
+	          << std::endl;
+}
+
 int main() {
 	std::cout << "Starting LoggerQueue tests..." << std::endl;
 
 	try {
 		functional_test();
+		message_storage_test();
+		zero_copy_test();
+		deferred_message_test();
+		tail_ring_test();
+		shm_ring_test();
 		stress_test();
 		performance_test();
 
@@ -0,0 +1,204 @@
+#include "IO/io.h"
+#include "cached_queue/logger_queue.h"
+#include "format/logger_format.h"
+#include "logger/logger.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// 压力测试规模，可用第一个命令行参数放大，例如 ./test_stress 10
+size_t g_scale = 1;
+
+// 收集后台线程写出的每一行，只有后台线程写入
+struct Capture {
+	std::vector<std::string> lines;
+	size_t flushes { 0 };
+};
+
+class CaptureIO : public AbstractIO {
+public:
+	explicit CaptureIO(Capture& capture)
+	    : capture(capture) { }
+	void write_logger(const std::string& msg) override { capture.lines.push_back(msg); }
+	void force_flush() override { ++capture.flushes; }
+
+private:
+	Capture& capture;
+};
+
+// 确定性的伪随机数，每个生产者用自己的种子，保证每次运行的操作序列相同
+uint64_t next_random(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// 消息格式："<生产者> <序号> <填充>"，填充用于覆盖内联与溢出两种存储
+std::string make_message(size_t producer, size_t seq, size_t padding) {
+	std::string msg = std::to_string(producer) + " " + std::to_string(seq) + " ";
+	msg.append(padding, static_cast<char>('a' + seq % 26));
+	return msg;
+}
+
+// 校验每条记录恰好出现一次，且同一生产者内保持推送顺序
+void verify(const std::vector<std::string>& lines, size_t producers, size_t per_producer, std::string_view scenario) {
+	std::vector<size_t> next(producers, 0);
+	for (const auto& line : lines) {
+		const auto first = line.find(' ');
+		const auto second = line.find(' ', first + 1);
+		assert(first != std::string::npos && second != std::string::npos && "日志行格式损坏！");
+		const size_t producer = std::stoul(line.substr(0, first));
+		const size_t seq = std::stoul(line.substr(first + 1, second - first - 1));
+		assert(producer < producers && "未知的生产者！");
+		if (seq != next[producer]) {
+			std::cerr << scenario << "：生产者 " << producer << " 期望序号 " << next[producer] << "，实际 " << seq << "\n";
+			assert(false && "记录丢失、重复或乱序！");
+		}
+		++next[producer];
+		// 填充内容必须完整
+		const char fill = static_cast<char>('a' + seq % 26);
+		assert(line.find_first_not_of(fill, second + 1) == line.size() - 1 && line.back() == '\n' && "日志内容损坏！");
+	}
+	for (size_t p = 0; p < producers; ++p) {
+		if (next[p] != per_producer) {
+			std::cerr << scenario << "：生产者 " << p << " 只写出 " << next[p] << " / " << per_producer << " 条\n";
+			assert(false && "记录丢失！");
+		}
+	}
+}
+
+struct Scenario {
+	std::string_view name;
+	WaitStrategy strategy;
+	size_t format_threads;
+	bool sync_at_end; // false：不调用 sync_flush，直接析构，检查关闭时是否排空
+};
+
+// 多生产者通过 CCLogger 的各条推送路径写入，中途穿插 flush 与 sync_flush
+void logger_scenario(const Scenario& scenario) {
+	constexpr size_t producers = 6;
+	const size_t per_producer = 20000 * g_scale;
+	Capture capture;
+	capture.lines.reserve(producers * per_producer + 16);
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		WaitPolicy policy;
+		policy.strategy = scenario.strategy;
+		CCLogger logger(new CaptureIO(capture), policy);
+		logger.set_formattor(new DummyFormatFactory);
+		logger.set_format_threads(scenario.format_threads);
+
+		std::vector<std::thread> threads;
+		for (size_t p = 0; p < producers; ++p) {
+			threads.emplace_back([&logger, p, per_producer]() {
+				uint64_t state = p + 1;
+				for (size_t seq = 0; seq < per_producer; ++seq) {
+					const uint64_t dice = next_random(state);
+					// 约 1% 的消息超过内联容量，走溢出缓冲区
+					const size_t padding = dice % 100 == 0 ? LogMessage::kInlineCapacity + dice % 64 : dice % 48;
+					std::string msg = make_message(p, seq, padding);
+					switch ((dice >> 8) % 4) {
+					case 0:
+						logger.push_message(msg);
+						break;
+					case 1:
+						logger.push_message(std::move(msg));
+						break;
+					case 2:
+						logger.push_deferred([msg = std::move(msg)]() { return msg; });
+						break;
+					default:
+						logger.push_message(std::string_view(msg), LogLevel::INFO);
+						break;
+					}
+					if ((dice >> 16) % 4096 == 0) {
+						logger.sync_flush();
+					} else if ((dice >> 16) % 512 == 0) {
+						logger.flush();
+					}
+				}
+			});
+		}
+		for (auto& th : threads) {
+			th.join();
+		}
+		if (scenario.sync_at_end) {
+			logger.sync_flush();
+			assert(capture.flushes > 0);
+		}
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	verify(capture.lines, producers, per_producer, scenario.name);
+	std::cout << scenario.name << "：" << capture.lines.size() << " 条全部按序写出，"
+	          << static_cast<uint64_t>(capture.lines.size() / seconds) << " 条/秒\n";
+}
+
+// 队列层：多生产者入队的同时由一个消费者不断 drain
+void queue_scenario() {
+	constexpr size_t producers = 8;
+	const size_t per_producer = 50000 * g_scale;
+	LoggerQueue queue;
+	std::vector<std::string> lines;
+	lines.reserve(producers * per_producer);
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < producers; ++p) {
+		threads.emplace_back([&queue, p, per_producer]() {
+			for (size_t seq = 0; seq < per_producer; ++seq) {
+				queue.enqueue(make_message(p, seq, seq % 300) + "\n");
+			}
+		});
+	}
+	std::vector<LogRecord> batch;
+	while (lines.size() < producers * per_producer) {
+		queue.drain(batch);
+		for (const auto& record : batch) {
+			lines.push_back(record.message.str());
+		}
+		if (batch.empty()) {
+			std::this_thread::yield();
+		}
+	}
+	for (auto& th : threads) {
+		th.join();
+	}
+	queue.drain(batch);
+	assert(batch.empty() && queue.approx_size() == 0 && "队列中残留了多余的记录！");
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	verify(lines, producers, per_producer, "queue_drain");
+	std::cout << "queue_drain：" << lines.size() << " 条全部按序取出，"
+	          << static_cast<uint64_t>(lines.size() / seconds) << " 条/秒\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1) {
+		g_scale = std::max<size_t>(std::strtoul(argv[1], nullptr, 10), 1);
+	}
+	std::cout << "==== 并发压力测试（规模 x" << g_scale << "） ====" << std::endl;
+	queue_scenario();
+	const Scenario scenarios[] = {
+		{ "blocking", WaitStrategy::Blocking, 0, true },
+		{ "busy_spin", WaitStrategy::BusySpin, 0, true },
+		{ "spin_yield", WaitStrategy::SpinYield, 0, true },
+		{ "timed_batch", WaitStrategy::TimedBatch, 0, true },
+		{ "format_pool", WaitStrategy::Blocking, 2, true },
+		{ "shutdown_drain", WaitStrategy::TimedBatch, 2, false },
+	};
+	for (const auto& scenario : scenarios) {
+		logger_scenario(scenario);
+	}
+	std::cout << "==== 压力测试全部通过！ ====" << std::endl;
+	return 0;
+}
@@ -40,3 +40,17 @@
  */
 #define PROPERTY_GET_SET(property) \
 	__PROPERTY_GET_SET(typeof(property), property)
+
+
+/**
+ * @brief Marks the tiny helpers on the logging hot path. With
+ *        CCLOGGER_FORCE_INLINE defined (the default, see the CMake
+ *        option of the same name) they are always inlined, also into
+ *        user code calling across the library boundary; otherwise the
+ *        compiler decides as usual
+ */
+#if defined(CCLOGGER_FORCE_INLINE) && (defined(__GNUC__) || defined(__clang__))
+#define CCLOGGER_HOT_INLINE inline __attribute__((always_inline))
+#else
+#define CCLOGGER_HOT_INLINE inline
+#endif